@@ -17,9 +17,6 @@
 
 namespace astyle {
 //
-// this must be global
-static int g_preprocessorCppExternCBrace;
-
 //-----------------------------------------------------------------------------
 // ASBeautifier class
 //-----------------------------------------------------------------------------
@@ -35,9 +32,11 @@ ASBeautifier::ASBeautifier()
 	activeBeautifierStack = nullptr;
 	waitingBeautifierStackLengthStack = nullptr;
 	activeBeautifierStackLengthStack = nullptr;
+	beautifierPool = nullptr;
 
 	headerStack = nullptr;
 	tempStacks = nullptr;
+	tempStacksPool = new vector<vector<const string*>*>;
 	parenDepthStack = nullptr;
 	blockStatementStack = nullptr;
 	parenStatementStack = nullptr;
@@ -72,14 +71,15 @@ ASBeautifier::ASBeautifier()
 	setAlignMethodColon(false);
 
 	// initialize ASBeautifier member vectors
+	// they are set to the shared keyword lists by initVectors()
 	beautifierFileType = 9;		// reset to an invalid type
-	headers = new vector<const string*>;
-	nonParenHeaders = new vector<const string*>;
-	assignmentOperators = new vector<const string*>;
-	nonAssignmentOperators = new vector<const string*>;
-	preBlockStatements = new vector<const string*>;
-	preCommandHeaders = new vector<const string*>;
-	indentableHeaders = new vector<const string*>;
+	headers = nullptr;
+	nonParenHeaders = nullptr;
+	assignmentOperators = nullptr;
+	nonAssignmentOperators = nullptr;
+	preBlockStatements = nullptr;
+	preCommandHeaders = nullptr;
+	indentableHeaders = nullptr;
 }
 
 /**
@@ -98,41 +98,50 @@ ASBeautifier::ASBeautifier(const ASBeautifier& other) : ASBase(other)
 	activeBeautifierStack = nullptr;
 	waitingBeautifierStackLengthStack = nullptr;
 	activeBeautifierStackLengthStack = nullptr;
-
-	// vector '=' operator performs a DEEP copy of all elements in the vector
+	beautifierPool = nullptr;
 
 	headerStack = new vector<const string*>;
-	*headerStack = *other.headerStack;
+	tempStacks = new vector<vector<const string*>*>;
+	tempStacksPool = new vector<vector<const string*>*>;
+	parenDepthStack = new vector<int>;
+	blockStatementStack = new vector<bool>;
+	parenStatementStack = new vector<bool>;
+	braceBlockStateStack = new vector<bool>;
+	continuationIndentStack = new vector<int>;
+	continuationIndentStackSizeStack = new vector<size_t>;
+	parenIndentStack = new vector<int>;
+	preprocIndentStack = new vector<pair<int, int> >;
 
-	tempStacks = copyTempStacks(other);
+	copyBeautifierState(other);
+}
 
-	parenDepthStack = new vector<int>;
-	*parenDepthStack = *other.parenDepthStack;
+/**
+ * Copy the state of another ASBeautifier to this cloned ASBeautifier.
+ * The vector objects must have been created by the copy constructor.
+ * A clone that is reused by cloneBeautifier() keeps the capacity of
+ * its vectors, so copying the state does not allocate memory.
+ * A clone does not have a beautifierPool. Only the original ASBeautifier,
+ * which owns the beautifier stacks, calls cloneBeautifier() and
+ * recycleBeautifier(). A clone never processes a preprocessor statement.
+ */
+void ASBeautifier::copyBeautifierState(const ASBeautifier& other)
+{
+	ASBase::operator=(other);
 
-	blockStatementStack = new vector<bool>;
+	// vector '=' operator performs a DEEP copy of all elements in the vector
+	*headerStack = *other.headerStack;
+	copyTempStacks(other);
+	*parenDepthStack = *other.parenDepthStack;
 	*blockStatementStack = *other.blockStatementStack;
-
-	parenStatementStack = new vector<bool>;
 	*parenStatementStack = *other.parenStatementStack;
-
-	braceBlockStateStack = new vector<bool>;
 	*braceBlockStateStack = *other.braceBlockStateStack;
-
-	continuationIndentStack = new vector<int>;
 	*continuationIndentStack = *other.continuationIndentStack;
-
-	continuationIndentStackSizeStack = new vector<size_t>;
 	*continuationIndentStackSizeStack = *other.continuationIndentStackSizeStack;
-
-	parenIndentStack = new vector<int>;
 	*parenIndentStack = *other.parenIndentStack;
-
-	preprocIndentStack = new vector<pair<int, int> >;
 	*preprocIndentStack = *other.preprocIndentStack;
 
 	// Copy the pointers to vectors.
-	// This is ok because the original ASBeautifier object
-	// is not deleted until end of job.
+	// This is ok because the keyword lists are shared and read only.
 	beautifierFileType = other.beautifierFileType;
 	headers = other.headers;
 	nonParenHeaders = other.nonParenHeaders;
@@ -238,6 +247,8 @@ ASBeautifier::ASBeautifier(const ASBeautifier& other) : ASBase(other)
 	spaceIndentObjCMethodAlignment = other.spaceIndentObjCMethodAlignment;
 	bracePosObjCMethodAlignment = other.bracePosObjCMethodAlignment;
 	colonIndentObjCMethodAlignment = other.colonIndentObjCMethodAlignment;
+	keywordIndentObjCMethodAlignment = other.keywordIndentObjCMethodAlignment;
+	preprocessorCppExternCBrace = other.preprocessorCppExternCBrace;
 	lineOpeningBlocksNum = other.lineOpeningBlocksNum;
 	lineClosingBlocksNum = other.lineClosingBlocksNum;
 	fileType = other.fileType;
@@ -270,10 +281,12 @@ ASBeautifier::~ASBeautifier()
 {
 	deleteBeautifierContainer(waitingBeautifierStack);
 	deleteBeautifierContainer(activeBeautifierStack);
+	deleteBeautifierContainer(beautifierPool);
 	deleteContainer(waitingBeautifierStackLengthStack);
 	deleteContainer(activeBeautifierStackLengthStack);
 	deleteContainer(headerStack);
 	deleteTempStacksContainer(tempStacks);
+	deleteTempStacksContainer(tempStacksPool);
 	deleteContainer(parenDepthStack);
 	deleteContainer(blockStatementStack);
 	deleteContainer(parenStatementStack);
@@ -300,30 +313,31 @@ void ASBeautifier::init(ASSourceIterator* iter)
 	sourceIterator = iter;
 	initVectors();
 	ASBase::init(getFileType());
-	g_preprocessorCppExternCBrace = 0;
+	preprocessorCppExternCBrace = 0;
 
-	initContainer(waitingBeautifierStack, new vector<ASBeautifier*>);
-	initContainer(activeBeautifierStack, new vector<ASBeautifier*>);
+	// the vectors are kept for the following files, see initContainer()
+	initContainer(beautifierPool);
+	initBeautifierContainer(waitingBeautifierStack);
+	initBeautifierContainer(activeBeautifierStack);
 
-	initContainer(waitingBeautifierStackLengthStack, new vector<size_t>);
-	initContainer(activeBeautifierStackLengthStack, new vector<size_t>);
+	initContainer(waitingBeautifierStackLengthStack);
+	initContainer(activeBeautifierStackLengthStack);
 
-	initContainer(headerStack, new vector<const string*>);
+	initContainer(headerStack);
 
-	initTempStacksContainer(tempStacks, new vector<vector<const string*>*>);
-	tempStacks->emplace_back(new vector<const string*>);
+	initTempStacksContainer(tempStacks);
 
-	initContainer(parenDepthStack, new vector<int>);
-	initContainer(blockStatementStack, new vector<bool>);
-	initContainer(parenStatementStack, new vector<bool>);
-	initContainer(braceBlockStateStack, new vector<bool>);
+	initContainer(parenDepthStack);
+	initContainer(blockStatementStack);
+	initContainer(parenStatementStack);
+	initContainer(braceBlockStateStack);
 	// do not use emplace_back on vector<bool> until supported by macOS
 	braceBlockStateStack->push_back(true);
-	initContainer(continuationIndentStack, new vector<int>);
-	initContainer(continuationIndentStackSizeStack, new vector<size_t>);
+	initContainer(continuationIndentStack);
+	initContainer(continuationIndentStackSizeStack);
 	continuationIndentStackSizeStack->emplace_back(0);
-	initContainer(parenIndentStack, new vector<int>);
-	initContainer(preprocIndentStack, new vector<pair<int, int> >);
+	initContainer(parenIndentStack);
+	initContainer(preprocIndentStack);
 
 	previousLastLineHeader = nullptr;
 	currentHeader = nullptr;
@@ -365,6 +379,7 @@ void ASBeautifier::init(ASSourceIterator* iter)
 	spaceIndentObjCMethodAlignment = 0;
 	bracePosObjCMethodAlignment = 0;
 	colonIndentObjCMethodAlignment = 0;
+	keywordIndentObjCMethodAlignment = 0;
 	lineOpeningBlocksNum = 0;
 	lineClosingBlocksNum = 0;
 	templateDepth = 0;
@@ -427,21 +442,14 @@ void ASBeautifier::initVectors()
 
 	beautifierFileType = fileType;
 
-	headers->clear();
-	nonParenHeaders->clear();
-	assignmentOperators->clear();
-	nonAssignmentOperators->clear();
-	preBlockStatements->clear();
-	preCommandHeaders->clear();
-	indentableHeaders->clear();
-
-	ASResource::buildHeaders(headers, fileType, true);
-	ASResource::buildNonParenHeaders(nonParenHeaders, fileType, true);
-	ASResource::buildAssignmentOperators(assignmentOperators);
-	ASResource::buildNonAssignmentOperators(nonAssignmentOperators);
-	ASResource::buildPreBlockStatements(preBlockStatements, fileType);
-	ASResource::buildPreCommandHeaders(preCommandHeaders, fileType);
-	ASResource::buildIndentableHeaders(indentableHeaders);
+	const ASKeywordTables* tables = ASResource::getKeywordTables(fileType);
+	headers = &tables->beautifierHeaders;
+	nonParenHeaders = &tables->beautifierNonParenHeaders;
+	assignmentOperators = &tables->assignmentOperators;
+	nonAssignmentOperators = &tables->nonAssignmentOperators;
+	preBlockStatements = &tables->preBlockStatements;
+	preCommandHeaders = &tables->preCommandHeaders;
+	indentableHeaders = &tables->indentableHeaders;
 }
 
 /**
@@ -454,7 +462,23 @@ void ASBeautifier::initVectors()
  */
 string ASBeautifier::beautify(const string& originalLine)
 {
-	string line;
+	string indentedLine;
+	beautify(originalLine, indentedLine);
+	return indentedLine;
+}
+
+/**
+ * beautify a line of source code into a buffer supplied by the caller.
+ * The buffer and the trimmed line keep their memory for the following lines,
+ * so a line is usually indented without allocating memory.
+ *
+ * @param originalLine       the original unindented line.
+ * @param indentedLine       receives the indented line, must not be the originalLine.
+ */
+void ASBeautifier::beautify(const string& originalLine, string& indentedLine)
+{
+	string& line = trimmedLine;
+	line.clear();
 	bool isInQuoteContinuation = isInVerbatimQuote || haveLineContinuationChar;
 
 	currentHeader = nullptr;
@@ -519,7 +543,7 @@ string ASBeautifier::beautify(const string& originalLine)
 	}
 	else
 	{
-		line = trim(originalLine);
+		trim(originalLine, line);
 		if (line.length() > 0)
 		{
 			if (line[0] == '{')
@@ -571,20 +595,29 @@ string ASBeautifier::beautify(const string& originalLine)
 				{
 					ASBeautifier* defineBeautifier = activeBeautifierStack->back();
 					activeBeautifierStack->pop_back();
-					delete defineBeautifier;
+					recycleBeautifier(defineBeautifier);
 				}
 			}
 		}
 		if (emptyLineFill && !isInQuoteContinuation)
 		{
 			if (isInIndentablePreprocBlock)
-				return preLineWS(preprocBlockIndent, 0);
+			{
+				preLineWS(indentedLine, preprocBlockIndent, 0);
+				return;
+			}
 			if (!headerStack->empty() || isInEnum)
-				return preLineWS(prevFinalLineIndentCount, prevFinalLineSpaceIndentCount);
+			{
+				preLineWS(indentedLine, prevFinalLineIndentCount, prevFinalLineSpaceIndentCount);
+				return;
+			}
 			// must fall thru here
 		}
 		else
-			return line;
+		{
+			indentedLine.clear();
+			return;
+		}
 	}
 
 	// handle preprocessor commands
@@ -592,16 +625,16 @@ string ASBeautifier::beautify(const string& originalLine)
 	        && line.length() > 0
 	        && line[0] != '#')
 	{
-		string indentedLine;
 		if (isInClassHeaderTab || isInClassInitializer)
 		{
 			// parsing is turned off in ASFormatter by indent-off
 			// the originalLine will probably never be returned here
-			indentedLine = preLineWS(prevFinalLineIndentCount, prevFinalLineSpaceIndentCount) + line;
-			return getIndentedLineReturn(indentedLine, originalLine);
+			setIndentedLine(indentedLine, line, originalLine,
+			                prevFinalLineIndentCount, prevFinalLineSpaceIndentCount);
+			return;
 		}
-		indentedLine = preLineWS(preprocBlockIndent, 0) + line;
-		return getIndentedLineReturn(indentedLine, originalLine);
+		setIndentedLine(indentedLine, line, originalLine, preprocBlockIndent, 0);
+		return;
 	}
 
 	if (!isInComment
@@ -616,31 +649,29 @@ string ASBeautifier::beautify(const string& originalLine)
 			processPreprocessor(preproc, line);
 			if (isInIndentablePreprocBlock || isInIndentablePreproc)
 			{
-				string indentedLine;
 				if (preproc.length() >= 2 && preproc.substr(0, 2) == "if") // #if, #ifdef, #ifndef
 				{
-					indentedLine = preLineWS(preprocBlockIndent, 0) + line;
+					setIndentedLine(indentedLine, line, originalLine, preprocBlockIndent, 0);
 					preprocBlockIndent += 1;
 					isInIndentablePreprocBlock = true;
 				}
 				else if (preproc == "else" || preproc == "elif")
 				{
-					indentedLine = preLineWS(preprocBlockIndent - 1, 0) + line;
+					setIndentedLine(indentedLine, line, originalLine, preprocBlockIndent - 1, 0);
 				}
 				else if (preproc == "endif")
 				{
 					preprocBlockIndent -= 1;
-					indentedLine = preLineWS(preprocBlockIndent, 0) + line;
+					setIndentedLine(indentedLine, line, originalLine, preprocBlockIndent, 0);
 					if (preprocBlockIndent == 0)
 						isInIndentablePreprocBlock = false;
 				}
 				else
-					indentedLine = preLineWS(preprocBlockIndent, 0) + line;
-				return getIndentedLineReturn(indentedLine, originalLine);
+					setIndentedLine(indentedLine, line, originalLine, preprocBlockIndent, 0);
+				return;
 			}
 			if (shouldIndentPreprocConditional && preproc.length() > 0)
 			{
-				string indentedLine;
 				if (preproc.length() >= 2 && preproc.substr(0, 2) == "if") // #if, #ifdef, #ifndef
 				{
 					pair<int, int> entry;	// indentCount, spaceIndentCount
@@ -649,27 +680,30 @@ string ASBeautifier::beautify(const string& originalLine)
 					else
 						entry = computePreprocessorIndent();
 					preprocIndentStack->emplace_back(entry);
-					indentedLine = preLineWS(preprocIndentStack->back().first,
-					                         preprocIndentStack->back().second) + line;
-					return getIndentedLineReturn(indentedLine, originalLine);
+					setIndentedLine(indentedLine, line, originalLine,
+					                preprocIndentStack->back().first,
+					                preprocIndentStack->back().second);
+					return;
 				}
 				if (preproc == "else" || preproc == "elif")
 				{
 					if (!preprocIndentStack->empty())	// if no entry don't indent
 					{
-						indentedLine = preLineWS(preprocIndentStack->back().first,
-						                         preprocIndentStack->back().second) + line;
-						return getIndentedLineReturn(indentedLine, originalLine);
+						setIndentedLine(indentedLine, line, originalLine,
+						                preprocIndentStack->back().first,
+						                preprocIndentStack->back().second);
+						return;
 					}
 				}
 				else if (preproc == "endif")
 				{
 					if (!preprocIndentStack->empty())	// if no entry don't indent
 					{
-						indentedLine = preLineWS(preprocIndentStack->back().first,
-						                         preprocIndentStack->back().second) + line;
+						setIndentedLine(indentedLine, line, originalLine,
+						                preprocIndentStack->back().first,
+						                preprocIndentStack->back().second);
 						preprocIndentStack->pop_back();
-						return getIndentedLineReturn(indentedLine, originalLine);
+						return;
 					}
 				}
 			}
@@ -690,18 +724,28 @@ string ASBeautifier::beautify(const string& originalLine)
 			isInDefineDefinition = false;
 			// this could happen with invalid input
 			if (activeBeautifierStack->empty())
-				return originalLine;
+			{
+				indentedLine = originalLine;
+				return;
+			}
 			ASBeautifier* defineBeautifier = activeBeautifierStack->back();
 			activeBeautifierStack->pop_back();
 
-			string indentedLine = defineBeautifier->beautify(line);
-			delete defineBeautifier;
-			return getIndentedLineReturn(indentedLine, originalLine);
+			defineBeautifier->preprocessorCppExternCBrace = preprocessorCppExternCBrace;
+			defineBeautifier->beautify(line, indentedLine);
+			preprocessorCppExternCBrace = defineBeautifier->preprocessorCppExternCBrace;
+			recycleBeautifier(defineBeautifier);
+			if (isIndentModeOff)
+				indentedLine = originalLine;
+			return;
 		}
 
 		// unless this is a multi-line #define, return this precompiler line as is.
 		if (!isInDefine && !isInDefineDefinition)
-			return originalLine;
+		{
+			indentedLine = originalLine;
+			return;
+		}
 	}
 
 	// if there exists any worker beautifier in the activeBeautifierStack,
@@ -723,8 +767,12 @@ string ASBeautifier::beautify(const string& originalLine)
 		activeBeautifierStack->back()->isInBeautifySQL = isInBeautifySQL;
 		activeBeautifierStack->back()->isInIndentableStruct = isInIndentableStruct;
 		activeBeautifierStack->back()->isInIndentablePreproc = isInIndentablePreproc;
-		// must return originalLine not the trimmed line
-		return activeBeautifierStack->back()->beautify(originalLine);
+		activeBeautifierStack->back()->preprocessorCppExternCBrace = preprocessorCppExternCBrace;
+		// must use originalLine not the trimmed line
+		activeBeautifierStack->back()->beautify(originalLine, indentedLine);
+		// the active beautifier may have found the extern "C"
+		preprocessorCppExternCBrace = activeBeautifierStack->back()->preprocessorCppExternCBrace;
+		return;
 	}
 
 	// Flag an indented header in case this line is a one-line block.
@@ -785,8 +833,7 @@ string ASBeautifier::beautify(const string& originalLine)
 
 	// finally, insert indentations into beginning of line
 
-	string indentedLine = preLineWS(indentCount, spaceIndentCount) + line;
-	indentedLine = getIndentedLineReturn(indentedLine, originalLine);
+	setIndentedLine(indentedLine, line, originalLine, indentCount, spaceIndentCount);
 
 	prevFinalLineSpaceIndentCount = spaceIndentCount;
 	prevFinalLineIndentCount = indentCount;
@@ -797,8 +844,6 @@ string ASBeautifier::beautify(const string& originalLine)
 	if ((lineIsLineCommentOnly || lineIsCommentOnly)
 	        && line.find("*INDENT-ON*", 0) != string::npos)
 		isIndentModeOff = false;
-
-	return indentedLine;
 }
 
 /**
@@ -1247,14 +1292,26 @@ int ASBeautifier::getTabLength() const
 	return tabLength;
 }
 
-const string& ASBeautifier::getIndentedLineReturn(const string& newLine, const string& originalLine) const
+/**
+ * set the indented line to the indentation followed by the trimmed line.
+ * The original line is used if indent is off.
+ */
+void ASBeautifier::setIndentedLine(string& indentedLine, const string& line, const string& originalLine,
+                                   int lineIndentCount, int lineSpaceIndentCount) const
 {
 	if (isIndentModeOff)
-		return originalLine;
-	return newLine;
+	{
+		indentedLine = originalLine;
+		return;
+	}
+	preLineWS(indentedLine, lineIndentCount, lineSpaceIndentCount);
+	indentedLine.append(line);
 }
 
-string ASBeautifier::preLineWS(int lineIndentCount, int lineSpaceIndentCount) const
+/**
+ * set the line to the white space for the indentation.
+ */
+void ASBeautifier::preLineWS(string& ws, int lineIndentCount, int lineSpaceIndentCount) const
 {
 	if (shouldForceTabIndentation)
 	{
@@ -1273,12 +1330,11 @@ string ASBeautifier::preLineWS(int lineIndentCount, int lineSpaceIndentCount) co
 		}
 	}
 
-	string ws;
+	ws.clear();
 	for (int i = 0; i < lineIndentCount; i++)
 		ws += indentString;
-	while ((lineSpaceIndentCount--) > 0)
-		ws += string(" ");
-	return ws;
+	if (lineSpaceIndentCount > 0)
+		ws.append(lineSpaceIndentCount, ' ');
 }
 
 /**
@@ -1468,6 +1524,19 @@ int ASBeautifier::convertTabToSpaces(int i, int tabIncrementIn) const
  * @param str       the line to trim.
  */
 string ASBeautifier::trim(const string& str) const
+{
+	string returnStr;
+	trim(str, returnStr);
+	return returnStr;
+}
+
+/**
+ * trim the white space surrounding a line into a reused string.
+ *
+ * @param str           the line to trim.
+ * @param trimmedStr    receives the trimmed line, must not be str.
+ */
+void ASBeautifier::trim(const string& str, string& trimmedStr) const
 {
 	int start = 0;
 	int end = str.length() - 1;
@@ -1482,8 +1551,7 @@ string ASBeautifier::trim(const string& str) const
 	if (end > -1 && str[end] == '\\')
 		end = str.length() - 1;
 
-	string returnStr(str, start, end + 1 - start);
-	return returnStr;
+	trimmedStr.assign(str, start, end + 1 - start);
 }
 
 /**
@@ -1506,35 +1574,45 @@ string ASBeautifier::rtrim(const string& str) const
 /**
  * Copy tempStacks for the copy constructor.
  * The value of the vectors must also be copied.
+ * The existing vectors of a reused clone are kept.
  */
-vector<vector<const string*>*>* ASBeautifier::copyTempStacks(const ASBeautifier& other) const
+void ASBeautifier::copyTempStacks(const ASBeautifier& other)
 {
-	vector<vector<const string*>*>* tempStacksNew = new vector<vector<const string*>*>;
-	vector<vector<const string*>*>::iterator iter;
-	for (iter = other.tempStacks->begin();
-	        iter != other.tempStacks->end();
-	        ++iter)
+	while (tempStacks->size() > other.tempStacks->size())
 	{
-		vector<const string*>* newVec = new vector<const string*>;
-		*newVec = **iter;
-		tempStacksNew->emplace_back(newVec);
+		recycleTempStack(tempStacks->back());
+		tempStacks->pop_back();
 	}
-	return tempStacksNew;
+	while (tempStacks->size() < other.tempStacks->size())
+		tempStacks->emplace_back(newTempStack());
+	for (size_t i = 0; i < other.tempStacks->size(); i++)
+		*(*tempStacks)[i] = *(*other.tempStacks)[i];
 }
 
 /**
- * delete a member vectors to eliminate memory leak reporting
+ * Get a clone of an ASBeautifier for a preprocessor branch or a #define.
+ * A clone from the beautifierPool is reused if there is one,
+ * otherwise a new clone is created with the copy constructor.
+ * The clone must be released with recycleBeautifier().
  */
-void ASBeautifier::deleteBeautifierVectors()
+ASBeautifier* ASBeautifier::cloneBeautifier(const ASBeautifier& other)
 {
-	beautifierFileType = 9;		// reset to an invalid type
-	delete headers;
-	delete nonParenHeaders;
-	delete preBlockStatements;
-	delete preCommandHeaders;
-	delete assignmentOperators;
-	delete nonAssignmentOperators;
-	delete indentableHeaders;
+	assert(beautifierPool != nullptr);	// not called by a clone
+	if (beautifierPool->empty())
+		return new ASBeautifier(other);
+	ASBeautifier* beautifier = beautifierPool->back();
+	beautifierPool->pop_back();
+	beautifier->copyBeautifierState(other);
+	return beautifier;
+}
+
+/**
+ * Release a clone from cloneBeautifier() to the beautifierPool.
+ */
+void ASBeautifier::recycleBeautifier(ASBeautifier* beautifier)
+{
+	assert(beautifierPool != nullptr);	// not called by a clone
+	beautifierPool->emplace_back(beautifier);
 }
 
 /**
@@ -1598,29 +1676,74 @@ void ASBeautifier::deleteTempStacksContainer(vector<vector<const string*>*>*& co
 
 /**
  * initialize a vector object
- * T is the type of vector used for all vectors
+ * T is the type of the vector elements, used for all vectors
+ * The vector is created for the first file. Since the ASFormatter object is
+ * reused, the vector is cleared for the following files. A cleared vector
+ * keeps its memory, so starting a new file does not allocate memory.
  */
 template<typename T>
-void ASBeautifier::initContainer(T& container, T value)
+void ASBeautifier::initContainer(vector<T>*& container)
+{
+	if (container == nullptr)
+		container = new vector<T>;
+	else
+		container->clear();
+}
+
+/**
+ * Initialize an ASBeautifier vector object.
+ * Any residual cloned beautifiers, from an #if without an #endif,
+ * are moved to the beautifierPool to be reused.
+ */
+void ASBeautifier::initBeautifierContainer(vector<ASBeautifier*>*& container)
 {
-	// since the ASFormatter object is never deleted,
-	// the existing vectors must be deleted before creating new ones
 	if (container != nullptr)
-		deleteContainer(container);
-	container = value;
+	{
+		for (ASBeautifier* beautifier : *container)
+			recycleBeautifier(beautifier);
+	}
+	initContainer(container);
 }
 
 /**
  * Initialize the tempStacks vector object.
  * The tempStacks is a vector of pointers to strings allocated with the 'new' operator.
- * Any residual entries are deleted before the vector is initialized.
+ * Any residual entries are deleted, except the default entry which is cleared.
  */
-void ASBeautifier::initTempStacksContainer(vector<vector<const string*>*>*& container,
-                                           vector<vector<const string*>*>* value)
+void ASBeautifier::initTempStacksContainer(vector<vector<const string*>*>*& container)
 {
-	if (container != nullptr)
-		deleteTempStacksContainer(container);
-	container = value;
+	if (container == nullptr)
+		container = new vector<vector<const string*>*>;
+	while (container->size() > 1)
+	{
+		recycleTempStack(container->back());
+		container->pop_back();
+	}
+	if (container->empty())
+		container->emplace_back(newTempStack());
+	container->back()->clear();
+}
+
+/**
+ * Get an empty vector for a new tempStacks entry.
+ * A vector removed from the tempStacks is reused if there is one.
+ */
+vector<const string*>* ASBeautifier::newTempStack()
+{
+	if (tempStacksPool->empty())
+		return new vector<const string*>;
+	vector<const string*>* tempStack = tempStacksPool->back();
+	tempStacksPool->pop_back();
+	return tempStack;
+}
+
+/**
+ * Keep a vector removed from the tempStacks to be reused by newTempStack().
+ */
+void ASBeautifier::recycleTempStack(vector<const string*>* tempStack)
+{
+	tempStack->clear();
+	tempStacksPool->emplace_back(tempStack);
 }
 
 /**
@@ -1951,7 +2074,7 @@ void ASBeautifier::processPreprocessor(const string& preproc, const string& line
 
 			// push a new beautifier into the active stack
 			// this beautifier will be used for the indentation of this define
-			ASBeautifier* defineBeautifier = new ASBeautifier(*this);
+			ASBeautifier* defineBeautifier = cloneBeautifier(*this);
 			activeBeautifierStack->emplace_back(defineBeautifier);
 		}
 		else
@@ -1962,15 +2085,15 @@ void ASBeautifier::processPreprocessor(const string& preproc, const string& line
 	}
 	else if (preproc.length() >= 2 && preproc.substr(0, 2) == "if")
 	{
-		if (isPreprocessorConditionalCplusplus(line) && !g_preprocessorCppExternCBrace)
-			g_preprocessorCppExternCBrace = 1;
+		if (isPreprocessorConditionalCplusplus(line) && !preprocessorCppExternCBrace)
+			preprocessorCppExternCBrace = 1;
 		// push a new beautifier into the stack
 		waitingBeautifierStackLengthStack->emplace_back(waitingBeautifierStack->size());
 		activeBeautifierStackLengthStack->emplace_back(activeBeautifierStack->size());
 		if (activeBeautifierStackLengthStack->back() == 0)
-			waitingBeautifierStack->emplace_back(new ASBeautifier(*this));
+			waitingBeautifierStack->emplace_back(cloneBeautifier(*this));
 		else
-			waitingBeautifierStack->emplace_back(new ASBeautifier(*activeBeautifierStack->back()));
+			waitingBeautifierStack->emplace_back(cloneBeautifier(*activeBeautifierStack->back()));
 	}
 	else if (preproc == "else")
 	{
@@ -1986,7 +2109,7 @@ void ASBeautifier::processPreprocessor(const string& preproc, const string& line
 		if ((waitingBeautifierStack != nullptr) && !waitingBeautifierStack->empty())
 		{
 			// append a COPY current waiting beautifier to active stack, WITHOUT deleting the original.
-			activeBeautifierStack->emplace_back(new ASBeautifier(*(waitingBeautifierStack->back())));
+			activeBeautifierStack->emplace_back(cloneBeautifier(*(waitingBeautifierStack->back())));
 		}
 	}
 	else if (preproc == "endif")
@@ -2002,7 +2125,7 @@ void ASBeautifier::processPreprocessor(const string& preproc, const string& line
 			{
 				beautifier = waitingBeautifierStack->back();
 				waitingBeautifierStack->pop_back();
-				delete beautifier;
+				recycleBeautifier(beautifier);
 			}
 		}
 
@@ -2014,7 +2137,7 @@ void ASBeautifier::processPreprocessor(const string& preproc, const string& line
 			{
 				beautifier = activeBeautifierStack->back();
 				activeBeautifierStack->pop_back();
-				delete beautifier;
+				recycleBeautifier(beautifier);
 			}
 		}
 	}
@@ -2150,7 +2273,7 @@ void ASBeautifier::computePreliminaryIndentation()
 
 	if (isInConditional)
 		--indentCount;
-	if (g_preprocessorCppExternCBrace >= 4)
+	if (preprocessorCppExternCBrace >= 4)
 		--indentCount;
 }
 
@@ -2311,7 +2434,6 @@ void ASBeautifier::adjustObjCMethodDefinitionIndentation(const string& line_)
 
 void ASBeautifier::adjustObjCMethodCallIndentation(const string& line_)
 {
-	static int keywordIndentObjCMethodAlignment = 0;
 	if (shouldAlignMethodColon && objCColonAlignSubsequent != -1)
 	{
 		if (isInObjCMethodCallFirst)
@@ -2597,8 +2719,8 @@ void ASBeautifier::parseCurrentLine(const string& line)
 				else if (isSharpStyle() && prevCh == '@')
 					isInVerbatimQuote = true;
 				// check for "C" following "extern"
-				else if (g_preprocessorCppExternCBrace == 2 && line.compare(i, 3, "\"C\"") == 0)
-					++g_preprocessorCppExternCBrace;
+				else if (preprocessorCppExternCBrace == 2 && line.compare(i, 3, "\"C\"") == 0)
+					++preprocessorCppExternCBrace;
 			}
 			else if (isInVerbatimQuote && ch == '"')
 			{
@@ -2992,8 +3114,8 @@ void ASBeautifier::parseCurrentLine(const string& line)
 			}
 
 			blockTabCount += (isContinuation ? 1 : 0);
-			if (g_preprocessorCppExternCBrace == 3)
-				++g_preprocessorCppExternCBrace;
+			if (preprocessorCppExternCBrace == 3)
+				++preprocessorCppExternCBrace;
 			parenDepth = 0;
 			isInTrailingReturnType = false;
 			isInClassHeader = false;
@@ -3007,7 +3129,7 @@ void ASBeautifier::parseCurrentLine(const string& line)
 			foundPreCommandMacro = false;
 			isInExternC = false;
 
-			tempStacks->emplace_back(new vector<const string*>);
+			tempStacks->emplace_back(newTempStack());
 			headerStack->emplace_back(&AS_OPEN_BRACE);
 			lastLineHeader = &AS_OPEN_BRACE;
 
@@ -3175,7 +3297,8 @@ void ASBeautifier::parseCurrentLine(const string& line)
 				{
 					headerStack->emplace_back(newHeader);
 					isContinuation = false;
-					if (indexOf(*nonParenHeaders, newHeader) == -1)
+					if (find(nonParenHeaders->begin(), nonParenHeaders->end(), newHeader)
+					        == nonParenHeaders->end())
 					{
 						isInConditional = true;
 					}
@@ -3411,7 +3534,7 @@ void ASBeautifier::parseCurrentLine(const string& line)
 					headerStack->pop_back();
 
 					if (headerStack->empty())
-						g_preprocessorCppExternCBrace = 0;
+						preprocessorCppExternCBrace = 0;
 
 					// do not indent namespace brace unless namespaces are indented
 					if (!namespaceIndent && !headerStack->empty()
@@ -3424,7 +3547,7 @@ void ASBeautifier::parseCurrentLine(const string& line)
 					{
 						vector<const string*>* temp = tempStacks->back();
 						tempStacks->pop_back();
-						delete temp;
+						recycleTempStack(temp);
 					}
 				}
 
@@ -3545,11 +3668,11 @@ void ASBeautifier::parseCurrentLine(const string& line)
 			if (isCStyle() && findKeyword(line, i, AS_OPERATOR))
 				isInOperator = true;
 
-			if (g_preprocessorCppExternCBrace == 1 && findKeyword(line, i, AS_EXTERN))
-				++g_preprocessorCppExternCBrace;
+			if (preprocessorCppExternCBrace == 1 && findKeyword(line, i, AS_EXTERN))
+				++preprocessorCppExternCBrace;
 
-			if (g_preprocessorCppExternCBrace == 3)	// extern "C" is not followed by a '{'
-				g_preprocessorCppExternCBrace = 0;
+			if (preprocessorCppExternCBrace == 3)	// extern "C" is not followed by a '{'
+				preprocessorCppExternCBrace = 0;
 
 			// "new" operator is a pointer, not a calculation
 			if (findKeyword(line, i, AS_NEW))
@@ -3586,8 +3709,8 @@ void ASBeautifier::parseCurrentLine(const string& line)
 			}
 
 			// bypass the entire name for all others
-			string name = getCurrentWord(line, i);
-			i += name.length() - 1;
+			size_t nameLength = getCurrentWordLength(line, i);
+			i += nameLength - 1;
 			continue;
 		}
 
@@ -34,7 +34,7 @@ void ASEnhancer::init(int  _fileType,
                       bool _preprocBlockIndent,
                       bool _preprocDefineIndent,
                       bool _emptyLineFill,
-                      vector<const pair<const string, const string>* >* _indentableMacros)
+                      const vector<const pair<const string, const string>* >* _indentableMacros)
 {
 	// formatting variables from ASFormatter and ASBeautifier
 	ASBase::init(_fileType);
@@ -52,7 +52,6 @@ void ASEnhancer::init(int  _fileType,
 
 	// unindent variables
 	lineNumber = 0;
-	braceCount = 0;
 	isInComment = false;
 	isInQuote = false;
 	switchDepth = 0;
@@ -366,6 +365,30 @@ bool ASEnhancer::isEndDeclareSectionSQL(const string& line, size_t index) const
 	return false;
 }
 
+/**
+ * check if the words in the current line must be checked for keywords.
+ * Outside of a switch, event table, or SQL, only a switch statement
+ * or an indentable macro changes the enhancer state. The line is
+ * searched for them once instead of checking every word.
+ */
+bool ASEnhancer::isKeywordCheckNeeded(const string& line, bool isInSQL) const
+{
+	if (switchDepth > 0
+	        || isInEventTable
+	        || isInDeclareSection
+	        || isInSQL)
+		return true;
+	if (line.find(ASResource::AS_SWITCH) != string::npos)
+		return true;
+	for (const auto* indentableMacro : *indentableMacros)
+	{
+		if (line.find(indentableMacro->first) != string::npos
+		        || line.find(indentableMacro->second) != string::npos)
+			return true;
+	}
+	return false;
+}
+
 /**
  * check if a one-line brace has been reached,
  * i.e. if the currently reached '{' character is closed
@@ -450,6 +473,14 @@ void ASEnhancer::parseCurrentLine(string& line, bool isInPreprocessor, bool isIn
 {
 	bool isSpecialChar = false;			// is a backslash escape character
 
+	// a line without keywords can change only the quote and comment state
+	bool isKeywordCheck = isKeywordCheckNeeded(line, isInSQL);
+	if (!isKeywordCheck
+	        && !isInComment
+	        && !isInQuote
+	        && line.find_first_of("\"'\\/") == string::npos)
+		return;
+
 	for (size_t i = 0; i < line.length(); i++)
 	{
 		char ch = line[i];
@@ -464,7 +495,7 @@ void ASEnhancer::parseCurrentLine(string& line, bool isInPreprocessor, bool isIn
 			isSpecialChar = false;
 			continue;
 		}
-		if (!(isInComment) && line.compare(i, 2, "\\\\") == 0)
+		if (!(isInComment) && ch == '\\' && line.compare(i, 2, "\\\\") == 0)
 		{
 			i++;
 			continue;
@@ -497,7 +528,7 @@ void ASEnhancer::parseCurrentLine(string& line, bool isInPreprocessor, bool isIn
 
 		// handle comments
 
-		if (!(isInComment) && line.compare(i, 2, "//") == 0)
+		if (!(isInComment) && ch == '/' && line.compare(i, 2, "//") == 0)
 		{
 			// check for windows line markers
 			if (line.compare(i + 2, 1, "\xf0") > 0)
@@ -509,7 +540,7 @@ void ASEnhancer::parseCurrentLine(string& line, bool isInPreprocessor, bool isIn
 				shouldUnindentComment = true;
 			break;                 // finished with the line
 		}
-		if (!(isInComment) && line.compare(i, 2, "/*") == 0)
+		if (!(isInComment) && ch == '/' && line.compare(i, 2, "/*") == 0)
 		{
 			// unindent if not in case braces
 			if (sw.switchBraceCount == 1 && sw.unindentCase)
@@ -522,7 +553,7 @@ void ASEnhancer::parseCurrentLine(string& line, bool isInPreprocessor, bool isIn
 				i = commentEnd - 1;
 			continue;
 		}
-		if ((isInComment) && line.compare(i, 2, "*/") == 0)
+		if ((isInComment) && ch == '*' && line.compare(i, 2, "*/") == 0)
 		{
 			// unindent if not in case braces
 			if (sw.switchBraceCount == 1 && sw.unindentCase)
@@ -546,11 +577,8 @@ void ASEnhancer::parseCurrentLine(string& line, bool isInPreprocessor, bool isIn
 
 		// if we have reached this far then we are NOT in a comment or string of special characters
 
-		if (line[i] == '{')
-			braceCount++;
-
-		if (line[i] == '}')
-			braceCount--;
+		if (!isKeywordCheck)
+			continue;
 
 		// check for preprocessor within an event table
 		if (isInEventTable && line[i] == '#' && preprocBlockIndent)
@@ -619,8 +647,8 @@ void ASEnhancer::parseCurrentLine(string& line, bool isInPreprocessor, bool isIn
 			// bypass the entire word
 			if (isPotentialKeyword)
 			{
-				string name = getCurrentWord(line, i);
-				i += name.length() - 1;
+				size_t nameLength = getCurrentWordLength(line, i);
+				i += nameLength - 1;
 			}
 			continue;
 		}
@@ -699,7 +727,6 @@ size_t ASEnhancer::processSwitchBlock(string& line, size_t index)
 		{
 			if (line[i] == '{')
 			{
-				braceCount++;
 				sw.switchBraceCount++;
 				if (!isOneLineBlockReached(line, i))
 					unindentNextLine = true;
@@ -712,8 +739,8 @@ size_t ASEnhancer::processSwitchBlock(string& line, size_t index)
 	}
 	if (isPotentialKeyword)
 	{
-		string name = getCurrentWord(line, i);          // bypass the entire name
-		i += name.length() - 1;
+		size_t nameLength = getCurrentWordLength(line, i);          // bypass the entire name
+		i += nameLength - 1;
 	}
 	return i;
 }
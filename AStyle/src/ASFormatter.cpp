@@ -85,17 +85,18 @@ ASFormatter::ASFormatter()
 	shouldUnPadParamType = false;
 
 	// initialize ASFormatter member vectors
+	// they are set to the shared keyword lists by buildLanguageVectors()
 	formatterFileType = 9;		// reset to an invalid type
-	headers = new vector<const string*>;
-	nonParenHeaders = new vector<const string*>;
-	preDefinitionHeaders = new vector<const string*>;
-	preCommandHeaders = new vector<const string*>;
-	operators = new vector<const string*>;
-	assignmentOperators = new vector<const string*>;
-	castOperators = new vector<const string*>;
+	headers = nullptr;
+	nonParenHeaders = nullptr;
+	preDefinitionHeaders = nullptr;
+	preCommandHeaders = nullptr;
+	operators = nullptr;
+	assignmentOperators = nullptr;
+	castOperators = nullptr;
 
 	// initialize ASEnhancer member vectors
-	indentableMacros = new vector<const pair<const string, const string>* >;
+	indentableMacros = nullptr;
 }
 
 /**
@@ -110,22 +111,8 @@ ASFormatter::~ASFormatter()
 	deleteContainer(structStack);
 	deleteContainer(questionMarkStack);
 
-	// delete ASFormatter member vectors
+	// the member vectors are shared keyword lists and are not deleted
 	formatterFileType = 9;		// reset to an invalid type
-	delete headers;
-	delete nonParenHeaders;
-	delete preDefinitionHeaders;
-	delete preCommandHeaders;
-	delete operators;
-	delete assignmentOperators;
-	delete castOperators;
-
-	// delete ASEnhancer member vectors
-	delete indentableMacros;
-
-	// must be done when the ASFormatter object is deleted (not ASBeautifier)
-	// delete ASBeautifier member vectors
-	ASBeautifier::deleteBeautifierVectors();
 
 	delete enhancer;
 }
@@ -146,6 +133,7 @@ void ASFormatter::init(ASSourceIterator* si)
 	fixOptionVariableConflicts();
 	ASBeautifier::init(si);
 	sourceIterator = si;
+	peekCache.clear();
 
 	enhancer->init(getFileType(),
 	               getIndentLength(),
@@ -159,12 +147,12 @@ void ASFormatter::init(ASSourceIterator* si)
 	               getEmptyLineFill(),
 	               indentableMacros);
 
-	initContainer(preBraceHeaderStack, new vector<const string*>);
-	initContainer(parenStack, new vector<int>);
-	initContainer(structStack, new vector<bool>);
-	initContainer(questionMarkStack, new vector<bool>);
+	initContainer(preBraceHeaderStack);
+	initContainer(parenStack);
+	initContainer(structStack);
+	initContainer(questionMarkStack);
 	parenStack->emplace_back(0);               // parenStack must contain this default entry
-	initContainer(braceTypeStack, new vector<BraceType>);
+	initContainer(braceTypeStack);
 	braceTypeStack->emplace_back(NULL_TYPE);   // braceTypeStack must contain this default entry
 	clearFormattedLineSplitPoints();
 
@@ -185,7 +173,7 @@ void ASFormatter::init(ASSourceIterator* si)
 	currentLineFirstBraceNum = string::npos;
 	formattedLineCommentNum = 0;
 	leadingSpaces = 0;
-	previousReadyFormattedLineLength = string::npos;
+	previousReadyFormattedLineIsEmpty = false;
 	preprocBraceTypeStackSize = 0;
 	spacePadNum = 0;
 	methodAttachCharNum = string::npos;
@@ -305,8 +293,9 @@ void ASFormatter::init(ASSourceIterator* si)
 }
 
 /**
- * build vectors for each programing language
+ * set the vectors for each programing language
  * depending on the file extension.
+ * the vectors are shared keyword lists built for the file type.
  */
 void ASFormatter::buildLanguageVectors()
 {
@@ -315,23 +304,15 @@ void ASFormatter::buildLanguageVectors()
 
 	formatterFileType = getFileType();
 
-	headers->clear();
-	nonParenHeaders->clear();
-	preDefinitionHeaders->clear();
-	preCommandHeaders->clear();
-	operators->clear();
-	assignmentOperators->clear();
-	castOperators->clear();
-	indentableMacros->clear();	// ASEnhancer
-
-	ASResource::buildHeaders(headers, getFileType());
-	ASResource::buildNonParenHeaders(nonParenHeaders, getFileType());
-	ASResource::buildPreDefinitionHeaders(preDefinitionHeaders, getFileType());
-	ASResource::buildPreCommandHeaders(preCommandHeaders, getFileType());
-	ASResource::buildOperators(operators, getFileType());
-	ASResource::buildAssignmentOperators(assignmentOperators);
-	ASResource::buildCastOperators(castOperators);
-	ASResource::buildIndentableMacros(indentableMacros);	//ASEnhancer
+	const ASKeywordTables* tables = ASResource::getKeywordTables(getFileType());
+	headers = &tables->headers;
+	nonParenHeaders = &tables->nonParenHeaders;
+	preDefinitionHeaders = &tables->preDefinitionHeaders;
+	preCommandHeaders = &tables->preCommandHeaders;
+	operators = &tables->operators;
+	assignmentOperators = &tables->assignmentOperators;
+	castOperators = &tables->castOperators;
+	indentableMacros = &tables->indentableMacros;	// ASEnhancer
 }
 
 /**
@@ -462,10 +443,12 @@ void ASFormatter::fixOptionVariableConflicts()
 
 /**
  * get the next formatted line.
+ * The line is built in a buffer that is reused for each line.
+ * It is valid until the next call and should be appended to the output.
  *
  * @return    formatted line.
  */
-string ASFormatter::nextLine()
+const string& ASFormatter::nextLine()
 {
 	const string* newHeader = nullptr;
 	isInVirginLine = isVirgin;
@@ -1643,8 +1626,9 @@ string ASFormatter::nextLine()
 			            || findKeyword(currentLine, charNum, AS_UNCHECKED)))
 				isSharpDelegate = true;
 
-			// append the entire name
-			string name = getCurrentWord(currentLine, charNum);
+			// append the entire name, the buffer keeps its memory for the next name
+			currentName.assign(currentLine, charNum, getCurrentWordLength(currentLine, charNum));
+			const string& name = currentName;
 			// must pad the 'and' and 'or' operators if required
 			if (name == "and" || name == "or")
 			{
@@ -1878,29 +1862,28 @@ string ASFormatter::nextLine()
 
 	// return a beautified (i.e. correctly indented) line.
 
-	string beautifiedLine;
-	size_t readyFormattedLineLength = trim(readyFormattedLine).length();
+	bool readyFormattedLineIsEmpty = readyFormattedLine.find_first_not_of(" \t") == string::npos;
 	bool isInNamespace = isBraceType(braceTypeStack->back(), NAMESPACE_TYPE);
 
 	if (prependEmptyLine		// prepend a blank line before this formatted line
-	        && readyFormattedLineLength > 0
-	        && previousReadyFormattedLineLength > 0)
+	        && !readyFormattedLineIsEmpty
+	        && !previousReadyFormattedLineIsEmpty)
 	{
 		isLineReady = true;		// signal a waiting readyFormattedLine
-		beautifiedLine = beautify("");
-		previousReadyFormattedLineLength = 0;
+		beautify(string(), beautifiedLineBuf);
+		previousReadyFormattedLineIsEmpty = true;
 		// call the enhancer for new empty lines
-		enhancer->enhance(beautifiedLine, isInNamespace, isInPreprocessorBeautify, isInBeautifySQL);
+		enhancer->enhance(beautifiedLineBuf, isInNamespace, isInPreprocessorBeautify, isInBeautifySQL);
 	}
 	else		// format the current formatted line
 	{
 		isLineReady = false;
 		runInIndentContinuation = runInIndentChars;
-		beautifiedLine = beautify(readyFormattedLine);
-		previousReadyFormattedLineLength = readyFormattedLineLength;
+		beautify(readyFormattedLine, beautifiedLineBuf);
+		previousReadyFormattedLineIsEmpty = readyFormattedLineIsEmpty;
 		// the enhancer is not called for no-indent line comments
 		if (!lineCommentNoBeautify && !isFormattingModeOff)
-			enhancer->enhance(beautifiedLine, isInNamespace, isInPreprocessorBeautify, isInBeautifySQL);
+			enhancer->enhance(beautifiedLineBuf, isInNamespace, isInPreprocessorBeautify, isInBeautifySQL);
 		runInIndentChars = 0;
 		lineCommentNoBeautify = lineCommentNoIndent;
 		lineCommentNoIndent = false;
@@ -1919,8 +1902,8 @@ string ASFormatter::nextLine()
 	}
 
 	prependEmptyLine = false;
-	assert(computeChecksumOut(beautifiedLine));
-	return beautifiedLine;
+	assert(computeChecksumOut(beautifiedLineBuf));
+	return beautifiedLineBuf;
 }
 
 /**
@@ -2621,7 +2604,8 @@ bool ASFormatter::getNextLine(bool emptyLineWasDeleted /*false*/)
 		currentLine = "{";		// append brace that was removed from the previous line
 	else
 	{
-		currentLine = sourceIterator->nextLine(emptyLineWasDeleted);
+		currentLine = sourceIterator->nextLineRef(emptyLineWasDeleted);
+		peekCache.nextLine(currentLine);
 		assert(computeChecksumIn(currentLine));
 	}
 	// reset variables for new line
@@ -3176,13 +3160,11 @@ bool ASFormatter::isPointerOrReference() const
 		lastWord = " ";
 
 	// check for preceding or following numeric values
-	string nextText = peekNextText(currentLine.substr(charNum + 1));
-	if (nextText.length() == 0)
-		nextText = " ";
+	char nextTextChar = peekNextTextChar(charNum + 1);
 	if (isDigit(lastWord[0])
-	        || isDigit(nextText[0])
-	        || nextText[0] == '!'
-	        || nextText[0] == '~')
+	        || isDigit(nextTextChar)
+	        || nextTextChar == '!'
+	        || nextTextChar == '~')
 		return false;
 
 	// check for multiply then a dereference (a * *b)
@@ -3211,10 +3193,8 @@ bool ASFormatter::isPointerOrReference() const
 			return true;
 		if (previousNonWSChar == '>')
 			return true;
-		string followingText;
-		if ((int) currentLine.length() > charNum + 2)
-			followingText = peekNextText(currentLine.substr(charNum + 2));
-		if (followingText.length() > 0 && followingText[0] == ')')
+		if ((int) currentLine.length() > charNum + 2
+		        && peekNextTextChar(charNum + 2) == ')')
 			return true;
 		if (currentHeader != nullptr || isInPotentialCalculation)
 			return false;
@@ -3355,15 +3335,12 @@ bool ASFormatter::isDereferenceOrAddressOf() const
 	            || parenStack->back() != 0))
 		return true;
 
-	string nextText = peekNextText(currentLine.substr(charNum + 1));
-	if (nextText.length() > 0)
-	{
-		if (nextText[0] == ')' || nextText[0] == '>'
-		        || nextText[0] == ',' || nextText[0] == '=')
-			return false;
-		if (nextText[0] == ';')
-			return true;
-	}
+	char nextTextChar = peekNextTextChar(charNum + 1);
+	if (nextTextChar == ')' || nextTextChar == '>'
+	        || nextTextChar == ',' || nextTextChar == '=')
+		return false;
+	if (nextTextChar == ';')
+		return true;
 
 	// check for reference to a pointer *&
 	if ((currentChar == '*' && nextChar == '&')
@@ -3382,7 +3359,7 @@ bool ASFormatter::isDereferenceOrAddressOf() const
 		return false;
 
 	bool isDA = (!(isLegalNameChar(previousNonWSChar) || previousNonWSChar == '>')
-	             || (nextText.length() > 0 && !isLegalNameChar(nextText[0]) && nextText[0] != '/')
+	             || (nextTextChar != '\0' && !isLegalNameChar(nextTextChar) && nextTextChar != '/')
 	             || (ispunct((unsigned char)previousNonWSChar) && previousNonWSChar != '.')
 	             || isCharImmediatelyPostReturn);
 
@@ -3856,26 +3833,69 @@ bool ASFormatter::isMultiStatementLine() const
  */
 string ASFormatter::peekNextText(const string& firstLine,
                                  bool endOnEmptyLine /*false*/,
-                                 const shared_ptr<ASPeekStream>& streamArg /*nullptr*/) const
+                                 ASPeekStream* streamArg /*nullptr*/) const
 {
 	assert(sourceIterator->getPeekStart() == 0 || streamArg != nullptr);	// Borland may need != 0
+	// the stream is reset at the end of this function unless it is supplied
+	ASPeekStream newStream(sourceIterator, &peekCache);
+	ASPeekStream* stream = (streamArg == nullptr) ? &newStream : streamArg;
+	const string* textLine = nullptr;
+	size_t textStart = findNextText(firstLine, 0, endOnEmptyLine, *stream, textLine);
+	if (textStart == string::npos)
+		return string();
+	return textLine->substr(textStart);
+}
+
+/**
+ * get the first character of the next non-whitespace text, bypassing all comments.
+ * The search starts in the currentLine. The text is not copied.
+ *
+ * @param   startChar   the position in the currentLine to start the search
+ * @return  the first character of the text, or '\0' if there is none.
+ */
+char ASFormatter::peekNextTextChar(size_t startChar) const
+{
+	assert(sourceIterator->getPeekStart() == 0);
+	ASPeekStream stream(sourceIterator, &peekCache);
+	const string* textLine = nullptr;
+	size_t textStart = findNextText(currentLine, startChar, false, stream, textLine);
+	if (textStart == string::npos)
+		return '\0';
+	return (*textLine)[textStart];
+}
+
+/**
+ * find the next non-whitespace text on following lines, bypassing all comments.
+ * The textLine is valid until another line is peeked from the stream.
+ *
+ * @param   firstLine        the first line to check
+ * @param   firstLineStart   the position in the first line to start the search
+ * @param   textLine         receives the line containing the text
+ * @return  the position of the text in textLine, or string::npos if none.
+ */
+size_t ASFormatter::findNextText(const string& firstLine, size_t firstLineStart,
+                                 bool endOnEmptyLine, ASPeekStream& stream,
+                                 const string*& textLine) const
+{
 	bool isFirstLine = true;
-	string nextLine_ = firstLine;
+	size_t searchStart = firstLineStart;
 	size_t firstChar = string::npos;
-	shared_ptr<ASPeekStream> stream = streamArg;
-	if (stream == nullptr)					// Borland may need == 0
-		stream = make_shared<ASPeekStream>(sourceIterator);
+	textLine = &firstLine;
 
 	// find the first non-blank text, bypassing all comments.
 	bool isInComment_ = false;
-	while (stream->hasMoreLines() || isFirstLine)
+	while (stream.hasMoreLines() || isFirstLine)
 	{
 		if (isFirstLine)
 			isFirstLine = false;
 		else
-			nextLine_ = stream->peekNextLine();
+		{
+			textLine = &stream.peekNextLine();
+			searchStart = 0;
+		}
+		const string& nextLine_ = *textLine;
 
-		firstChar = nextLine_.find_first_not_of(" \t");
+		firstChar = nextLine_.find_first_not_of(" \t", searchStart);
 		if (firstChar == string::npos)
 		{
 			if (endOnEmptyLine && !isInComment_)
@@ -3907,12 +3927,7 @@ string ASFormatter::peekNextText(const string& firstLine,
 		// found the next text
 		break;
 	}
-
-	if (firstChar == string::npos)
-		nextLine_ = "";
-	else
-		nextLine_ = nextLine_.substr(firstChar);
-	return nextLine_;
+	return firstChar;
 }
 
 /**
@@ -4004,6 +4019,26 @@ void ASFormatter::appendCharInsideComments()
 		shouldBreakLineAtNextChar = true;
 }
 
+/**
+ * Append the comment text from charNum to textEnd to the formatted line.
+ * Only the first character can break the line, the others are appended
+ * at once. Used when the characters do not need to be checked for tabs
+ * or split points.
+ *
+ * @param textEnd          the end of the comment text in currentLine.
+ */
+void ASFormatter::appendCommentText(size_t textEnd)
+{
+	assert(!shouldConvertTabs && maxCodeLength == string::npos);
+	if ((size_t) charNum >= textEnd)
+		return;
+	currentChar = currentLine[charNum];
+	appendCurrentChar();
+	formattedLine.append(currentLine, charNum + 1, textEnd - charNum - 1);
+	charNum = (int) textEnd;
+	currentChar = currentLine[textEnd - 1];
+}
+
 /**
  * add or remove space padding to operators
  * the operators and necessary padding will be appended to formattedLine
@@ -5504,26 +5539,29 @@ void ASFormatter::deleteContainer(T& container)
  * initialize a braceType vector object
  * braceType did not work with the DeleteContainer template
  */
-void ASFormatter::initContainer(vector<BraceType>*& container, vector<BraceType>* value)
+void ASFormatter::initContainer(vector<BraceType>*& container)
 {
-	if (container != nullptr)
-		deleteContainer(container);
-	container = value;
+	if (container == nullptr)
+		container = new vector<BraceType>;
+	else
+		container->clear();
 }
 
 /**
  * initialize a vector object
- * T is the type of vector
+ * T is the type of the vector elements
  * used for all vectors except braceTypeStack
+ * The vector is created for the first file. Since the ASFormatter object is
+ * reused, the vector is cleared for the following files. A cleared vector
+ * keeps its memory, so starting a new file does not allocate memory.
  */
 template<typename T>
-void ASFormatter::initContainer(T& container, T value)
+void ASFormatter::initContainer(vector<T>*& container)
 {
-	// since the ASFormatter object is never deleted,
-	// the existing vectors must be deleted before creating new ones
-	if (container != nullptr)
-		deleteContainer(container);
-	container = value;
+	if (container == nullptr)
+		container = new vector<T>;
+	else
+		container->clear();
 }
 
 /**
@@ -5592,12 +5630,14 @@ const string* ASFormatter::checkForHeaderFollowingComment(const string& firstLin
 	bool endOnEmptyLine = (currentHeader == nullptr);
 	if (isInSwitchStatement())
 		endOnEmptyLine = false;
-	string nextText = peekNextText(firstLine, endOnEmptyLine);
+	ASPeekStream stream(sourceIterator, &peekCache);
+	const string* textLine = nullptr;
+	size_t textStart = findNextText(firstLine, 0, endOnEmptyLine, stream, textLine);
 
-	if (nextText.length() == 0 || !isCharPotentialHeader(nextText, 0))
+	if (textStart == string::npos || !isCharPotentialHeader(*textLine, textStart))
 		return nullptr;
 
-	return ASBase::findHeader(nextText, 0, headers);
+	return ASBase::findHeader(*textLine, textStart, headers);
 }
 
 /**
@@ -5645,22 +5685,24 @@ bool ASFormatter::commentAndHeaderFollows()
 	assert(shouldDeleteEmptyLines && shouldBreakBlocks);
 
 	// is the next line a comment
-	auto stream = make_shared<ASPeekStream>(sourceIterator);
-	if (!stream->hasMoreLines())
+	ASPeekStream stream(sourceIterator, &peekCache);
+	if (!stream.hasMoreLines())
 		return false;
-	string nextLine_ = stream->peekNextLine();
+	// the peeked line is valid until the next line is peeked
+	const string& nextLine_ = stream.peekNextLine();
 	size_t firstChar = nextLine_.find_first_not_of(" \t");
 	if (firstChar == string::npos
 	        || !(nextLine_.compare(firstChar, 2, "//") == 0
 	             || nextLine_.compare(firstChar, 2, "/*") == 0))
 		return false;
 
-	// find the next non-comment text, and reset
-	string nextText = peekNextText(nextLine_, false, stream);
-	if (nextText.length() == 0 || !isCharPotentialHeader(nextText, 0))
+	// find the next non-comment text, the stream is reset on return
+	const string* textLine = nullptr;
+	size_t textStart = findNextText(nextLine_, 0, false, stream, textLine);
+	if (textStart == string::npos || !isCharPotentialHeader(*textLine, textStart))
 		return false;
 
-	const string* newHeader = ASBase::findHeader(nextText, 0, headers);
+	const string* newHeader = ASBase::findHeader(*textLine, textStart, headers);
 
 	if (newHeader == nullptr)
 		return false;
@@ -5791,19 +5833,33 @@ void ASFormatter::formatCommentBody()
 {
 	assert(isInComment);
 
-	// append the comment
-	while (charNum < (int) currentLine.length())
+	// without convert-tabs or max-code-length the text is appended at once
+	if (!shouldConvertTabs && maxCodeLength == string::npos)
 	{
-		currentChar = currentLine[charNum];
-		if (isSequenceReached("*/"))
+		size_t commentEnd = currentLine.find(AS_CLOSE_COMMENT, charNum);
+		appendCommentText(commentEnd == string::npos ? currentLine.length() : commentEnd);
+		if (commentEnd != string::npos)
 		{
+			currentChar = currentLine[charNum];
 			formatCommentCloser();
-			break;
 		}
-		if (currentChar == '\t' && shouldConvertTabs)
-			convertTabToSpaces();
-		appendCurrentChar();
-		++charNum;
+	}
+	else
+	{
+		// append the comment
+		while (charNum < (int) currentLine.length())
+		{
+			currentChar = currentLine[charNum];
+			if (isSequenceReached("*/"))
+			{
+				formatCommentCloser();
+				break;
+			}
+			if (currentChar == '\t' && shouldConvertTabs)
+				convertTabToSpaces();
+			appendCurrentChar();
+			++charNum;
+		}
 	}
 	if (shouldStripCommentPrefix)
 		stripCommentPrefix();
@@ -5941,15 +5997,21 @@ void ASFormatter::formatLineCommentBody()
 {
 	assert(isInLineComment);
 
-	// append the comment
-	while (charNum < (int) currentLine.length())
-//	        && !isLineReady	// commented out in release 2.04, unnecessary
+	// without convert-tabs or max-code-length the text is appended at once
+	if (!shouldConvertTabs && maxCodeLength == string::npos)
+		appendCommentText(currentLine.length());
+	else
 	{
-		currentChar = currentLine[charNum];
-		if (currentChar == '\t' && shouldConvertTabs)
-			convertTabToSpaces();
-		appendCurrentChar();
-		++charNum;
+		// append the comment
+		while (charNum < (int) currentLine.length())
+//		        && !isLineReady	// commented out in release 2.04, unnecessary
+		{
+			currentChar = currentLine[charNum];
+			if (currentChar == '\t' && shouldConvertTabs)
+				convertTabToSpaces();
+			appendCurrentChar();
+			++charNum;
+		}
 	}
 
 	// explicitly break a line when a line comment's end is found.
@@ -6450,7 +6512,7 @@ bool ASFormatter::removeBracesFromStatement()
 	size_t nextChar = 0;
 
 	// find the first non-blank text
-	ASPeekStream stream(sourceIterator);
+	ASPeekStream stream(sourceIterator, &peekCache);
 	while (stream.hasMoreLines() || isFirstLine)
 	{
 		if (isFirstLine)
@@ -6589,7 +6651,7 @@ void ASFormatter::findReturnTypeSplitPoint(const string& firstLine)
 	string line          = firstLine;
 
 	// Process the lines until a ';' or '{'.
-	ASPeekStream stream(sourceIterator);
+	ASPeekStream stream(sourceIterator, &peekCache);
 	while (stream.hasMoreLines() || isFirstLine)
 	{
 		if (isFirstLine)
@@ -6848,7 +6910,7 @@ bool ASFormatter::isStructAccessModified(const string& firstLine, size_t index)
 	bool isFirstLine = true;
 	size_t braceCount = 1;
 	string nextLine_ = firstLine.substr(index + 1);
-	ASPeekStream stream(sourceIterator);
+	ASPeekStream stream(sourceIterator, &peekCache);
 
 	// find the first non-blank text, bypassing all comments and quotes.
 	bool isInComment_ = false;
@@ -6915,8 +6977,8 @@ bool ASFormatter::isStructAccessModified(const string& firstLine, size_t index)
 				        || findKeyword(nextLine_, i, AS_PRIVATE)
 				        || findKeyword(nextLine_, i, AS_PROTECTED))
 					return true;
-				string name = getCurrentWord(nextLine_, i);
-				i += name.length() - 1;
+				size_t nameLength = getCurrentWordLength(nextLine_, i);
+				i += nameLength - 1;
 			}
 		}	// end of for loop
 	}	// end of while loop
@@ -6945,18 +7007,18 @@ bool ASFormatter::isIndentablePreprocessorBlock(const string& firstLine, size_t
 	int  numBlockIndents = 0;
 	int  lineParenCount = 0;
 	string nextLine_ = firstLine.substr(index);
-	auto stream = make_shared<ASPeekStream>(sourceIterator);
+	ASPeekStream stream(sourceIterator, &peekCache);
 
 	// find end of the block, bypassing all comments and quotes.
 	bool isInComment_ = false;
 	bool isInQuote_ = false;
 	char quoteChar_ = ' ';
-	while (stream->hasMoreLines() || isFirstLine)
+	while (stream.hasMoreLines() || isFirstLine)
 	{
 		if (isFirstLine)
 			isFirstLine = false;
 		else
-			nextLine_ = stream->peekNextLine();
+			nextLine_ = stream.peekNextLine();
 		// parse the line
 		for (size_t i = 0; i < nextLine_.length(); i++)
 		{
@@ -7067,7 +7129,7 @@ EndOfWhileLoop:
 		isInIndentableBlock = false;
 	// find next executable instruction
 	// this WILL RESET the get pointer
-	string nextText = peekNextText("", false, stream);
+	string nextText = peekNextText("", false, &stream);
 	// bypass header include guards
 	if (isFirstPreprocConditional)
 	{
@@ -7253,7 +7315,7 @@ void ASFormatter::checkIfTemplateOpener()
 	int maxTemplateDepth = 0;
 	templateDepth = 0;
 	string nextLine_ = currentLine.substr(charNum);
-	ASPeekStream stream(sourceIterator);
+	ASPeekStream stream(sourceIterator, &peekCache);
 
 	// find the angle braces, bypassing all comments and quotes.
 	bool isInComment_ = false;
@@ -7373,8 +7435,8 @@ void ASFormatter::checkIfTemplateOpener()
 				templateDepth = 0;
 				return;
 			}
-			string name = getCurrentWord(nextLine_, i);
-			i += name.length() - 1;
+			size_t nameLength = getCurrentWordLength(nextLine_, i);
+			i += nameLength - 1;
 		}	// end for loop
 	}	// end while loop
 }
@@ -7760,7 +7822,7 @@ size_t ASFormatter::findFormattedLineSplitPoint() const
 		// if end of the currentLine, find a new split point
 		size_t newCharNum;
 		if (!isWhiteSpace(currentChar) && isCharPotentialHeader(currentLine, charNum))
-			newCharNum = getCurrentWord(currentLine, charNum).length() + charNum;
+			newCharNum = getCurrentWordLength(currentLine, charNum) + charNum;
 		else
 			newCharNum = charNum + 2;
 		if (newCharNum + 1 > currentLine.length())
@@ -7988,7 +8050,7 @@ int ASFormatter::findObjCColonAlignment() const
 	int  colonAdjust = 0;
 	int  colonAlign = 0;
 	string nextLine_ = currentLine;
-	ASPeekStream stream(sourceIterator);
+	ASPeekStream stream(sourceIterator, &peekCache);
 
 	// peek next line
 	while (sourceIterator->hasMoreLines() || isFirstLine)
@@ -178,13 +178,99 @@ bool sortOnName(const string* a, const string* b)
 	return *a < *b;
 }
 
+/**
+ * Sort the keywords.
+ * The index must be rebuilt by buildIndex() after the sort.
+ *
+ * @param compare       the function used to compare the keywords.
+ */
+void ASKeywordList::sort(bool (*compare)(const string*, const string*))
+{
+	std::sort(keywords.begin(), keywords.end(), compare);
+	isIndexed = false;
+}
+
+/**
+ * Build the index of the keywords by first character.
+ * The keywords for each character are in the same order as the vector.
+ * Must be called after the vector is built and sorted.
+ */
+void ASKeywordList::buildIndex()
+{
+	assert(keywords.size() < 65536);
+	indexedKeywords.clear();
+	indexedKeywords.reserve(keywords.size());
+	for (size_t ch = 0; ch < 256; ch++)
+	{
+		charStart[ch] = static_cast<unsigned short>(indexedKeywords.size());
+		for (const string* keyword : keywords)
+		{
+			assert(!keyword->empty());
+			if ((unsigned char) (*keyword)[0] == ch)
+				indexedKeywords.emplace_back(keyword);
+		}
+	}
+	charStart[256] = static_cast<unsigned short>(indexedKeywords.size());
+	isIndexed = true;
+}
+
+/**
+ * Build the keyword lists for a file type.
+ * The beautifier headers and non-paren headers are built with the
+ * "beautifier" option. The other lists are the same for both.
+ *
+ * @param fileType      the file type of the lists to be built.
+ */
+ASKeywordTables::ASKeywordTables(int fileType)
+{
+	ASResource::buildHeaders(&headers, fileType);
+	ASResource::buildNonParenHeaders(&nonParenHeaders, fileType);
+	ASResource::buildPreDefinitionHeaders(&preDefinitionHeaders, fileType);
+	ASResource::buildOperators(&operators, fileType);
+	ASResource::buildCastOperators(&castOperators);
+	ASResource::buildHeaders(&beautifierHeaders, fileType, true);
+	ASResource::buildNonParenHeaders(&beautifierNonParenHeaders, fileType, true);
+	ASResource::buildNonAssignmentOperators(&nonAssignmentOperators);
+	ASResource::buildPreBlockStatements(&preBlockStatements, fileType);
+	ASResource::buildIndentableHeaders(&indentableHeaders);
+	ASResource::buildAssignmentOperators(&assignmentOperators);
+	ASResource::buildPreCommandHeaders(&preCommandHeaders, fileType);
+	ASResource::buildIndentableMacros(&indentableMacros);
+}
+
+/**
+ * Get the shared keyword lists for a file type.
+ * The lists are built on the first request for the file type.
+ * The initialization of a local static is thread safe in C++11,
+ * so concurrent formatters will wait for the lists to be built.
+ *
+ * @param fileType      the file type of the lists.
+ * @return              the read only keyword lists.
+ */
+const ASKeywordTables* ASResource::getKeywordTables(int fileType)
+{
+	if (fileType == JAVA_TYPE)
+	{
+		static const ASKeywordTables javaTables(JAVA_TYPE);
+		return &javaTables;
+	}
+	if (fileType == SHARP_TYPE)
+	{
+		static const ASKeywordTables sharpTables(SHARP_TYPE);
+		return &sharpTables;
+	}
+	assert(fileType == C_TYPE);
+	static const ASKeywordTables cTables(C_TYPE);
+	return &cTables;
+}
+
 /**
  * Build the vector of assignment operators.
  * Used by BOTH ASFormatter.cpp and ASBeautifier.cpp
  *
  * @param assignmentOperators   a reference to the vector to be built.
  */
-void ASResource::buildAssignmentOperators(vector<const string*>* assignmentOperators)
+void ASResource::buildAssignmentOperators(ASKeywordList* assignmentOperators)
 {
 	const size_t elements = 15;
 	assignmentOperators->reserve(elements);
@@ -208,7 +294,8 @@ void ASResource::buildAssignmentOperators(vector<const string*>* assignmentOpera
 	assignmentOperators->emplace_back(&AS_LS_LS_LS_ASSIGN);
 
 	assert(assignmentOperators->size() < elements);
-	sort(assignmentOperators->begin(), assignmentOperators->end(), sortOnLength);
+	assignmentOperators->sort(sortOnLength);
+	assignmentOperators->buildIndex();
 }
 
 /**
@@ -217,7 +304,7 @@ void ASResource::buildAssignmentOperators(vector<const string*>* assignmentOpera
  *
  * @param castOperators     a reference to the vector to be built.
  */
-void ASResource::buildCastOperators(vector<const string*>* castOperators)
+void ASResource::buildCastOperators(ASKeywordList* castOperators)
 {
 	const size_t elements = 5;
 	castOperators->reserve(elements);
@@ -228,7 +315,8 @@ void ASResource::buildCastOperators(vector<const string*>* castOperators)
 	castOperators->emplace_back(&AS_STATIC_CAST);
 
 	assert(castOperators->size() < elements);
-	sort(castOperators->begin(), castOperators->end(), sortOnName);
+	castOperators->sort(sortOnName);
+	castOperators->buildIndex();
 }
 
 /**
@@ -237,7 +325,7 @@ void ASResource::buildCastOperators(vector<const string*>* castOperators)
  *
  * @param headers       a reference to the vector to be built.
  */
-void ASResource::buildHeaders(vector<const string*>* headers, int fileType, bool beautifier)
+void ASResource::buildHeaders(ASKeywordList* headers, int fileType, bool beautifier)
 {
 	const size_t elements = 25;
 	headers->reserve(elements);
@@ -295,7 +383,8 @@ void ASResource::buildHeaders(vector<const string*>* headers, int fileType, bool
 	}
 
 	assert(headers->size() < elements);
-	sort(headers->begin(), headers->end(), sortOnName);
+	headers->sort(sortOnName);
+	headers->buildIndex();
 }
 
 /**
@@ -304,11 +393,12 @@ void ASResource::buildHeaders(vector<const string*>* headers, int fileType, bool
  *
  * @param indentableHeaders     a reference to the vector to be built.
  */
-void ASResource::buildIndentableHeaders(vector<const string*>* indentableHeaders)
+void ASResource::buildIndentableHeaders(ASKeywordList* indentableHeaders)
 {
 	indentableHeaders->emplace_back(&AS_RETURN);
 
-//	sort(indentableHeaders->begin(), indentableHeaders->end(), sortOnName);
+//	indentableHeaders->sort(sortOnName);
+	indentableHeaders->buildIndex();
 }
 
 /**
@@ -348,7 +438,7 @@ void ASResource::buildIndentableMacros(vector<const pair<const string, const str
  *
  * @param nonAssignmentOperators       a reference to the vector to be built.
  */
-void ASResource::buildNonAssignmentOperators(vector<const string*>* nonAssignmentOperators)
+void ASResource::buildNonAssignmentOperators(ASKeywordList* nonAssignmentOperators)
 {
 	const size_t elements = 15;
 	nonAssignmentOperators->reserve(elements);
@@ -369,7 +459,8 @@ void ASResource::buildNonAssignmentOperators(vector<const string*>* nonAssignmen
 	nonAssignmentOperators->emplace_back(&AS_LAMBDA);
 
 	assert(nonAssignmentOperators->size() < elements);
-	sort(nonAssignmentOperators->begin(), nonAssignmentOperators->end(), sortOnLength);
+	nonAssignmentOperators->sort(sortOnLength);
+	nonAssignmentOperators->buildIndex();
 }
 
 /**
@@ -379,7 +470,7 @@ void ASResource::buildNonAssignmentOperators(vector<const string*>* nonAssignmen
  *
  * @param nonParenHeaders       a reference to the vector to be built.
  */
-void ASResource::buildNonParenHeaders(vector<const string*>* nonParenHeaders, int fileType, bool beautifier)
+void ASResource::buildNonParenHeaders(ASKeywordList* nonParenHeaders, int fileType, bool beautifier)
 {
 	const size_t elements = 20;
 	nonParenHeaders->reserve(elements);
@@ -425,7 +516,8 @@ void ASResource::buildNonParenHeaders(vector<const string*>* nonParenHeaders, in
 	}
 
 	assert(nonParenHeaders->size() < elements);
-	sort(nonParenHeaders->begin(), nonParenHeaders->end(), sortOnName);
+	nonParenHeaders->sort(sortOnName);
+	nonParenHeaders->buildIndex();
 }
 
 /**
@@ -434,7 +526,7 @@ void ASResource::buildNonParenHeaders(vector<const string*>* nonParenHeaders, in
  *
  * @param operators             a reference to the vector to be built.
  */
-void ASResource::buildOperators(vector<const string*>* operators, int fileType)
+void ASResource::buildOperators(ASKeywordList* operators, int fileType)
 {
 	const size_t elements = 50;
 	operators->reserve(elements);
@@ -489,7 +581,8 @@ void ASResource::buildOperators(vector<const string*>* operators, int fileType)
 	}
 
 	assert(operators->size() < elements);
-	sort(operators->begin(), operators->end(), sortOnLength);
+	operators->sort(sortOnLength);
+	operators->buildIndex();
 }
 
 /**
@@ -499,7 +592,7 @@ void ASResource::buildOperators(vector<const string*>* operators, int fileType)
  *
  * @param preBlockStatements        a reference to the vector to be built.
  */
-void ASResource::buildPreBlockStatements(vector<const string*>* preBlockStatements, int fileType)
+void ASResource::buildPreBlockStatements(ASKeywordList* preBlockStatements, int fileType)
 {
 	const size_t elements = 10;
 	preBlockStatements->reserve(elements);
@@ -527,7 +620,8 @@ void ASResource::buildPreBlockStatements(vector<const string*>* preBlockStatemen
 	}
 
 	assert(preBlockStatements->size() < elements);
-	sort(preBlockStatements->begin(), preBlockStatements->end(), sortOnName);
+	preBlockStatements->sort(sortOnName);
+	preBlockStatements->buildIndex();
 }
 
 /**
@@ -539,7 +633,7 @@ void ASResource::buildPreBlockStatements(vector<const string*>* preBlockStatemen
  * the closing paren and the opening brace.
  * e.g. in "void foo() const {}", "const" is a preCommandHeader.
  */
-void ASResource::buildPreCommandHeaders(vector<const string*>* preCommandHeaders, int fileType)
+void ASResource::buildPreCommandHeaders(ASKeywordList* preCommandHeaders, int fileType)
 {
 	const size_t elements = 10;
 	preCommandHeaders->reserve(elements);
@@ -567,7 +661,8 @@ void ASResource::buildPreCommandHeaders(vector<const string*>* preCommandHeaders
 	}
 
 	assert(preCommandHeaders->size() < elements);
-	sort(preCommandHeaders->begin(), preCommandHeaders->end(), sortOnName);
+	preCommandHeaders->sort(sortOnName);
+	preCommandHeaders->buildIndex();
 }
 
 /**
@@ -578,7 +673,7 @@ void ASResource::buildPreCommandHeaders(vector<const string*>* preCommandHeaders
  *
  * @param preDefinitionHeaders      a reference to the vector to be built.
  */
-void ASResource::buildPreDefinitionHeaders(vector<const string*>* preDefinitionHeaders, int fileType)
+void ASResource::buildPreDefinitionHeaders(ASKeywordList* preDefinitionHeaders, int fileType)
 {
 	const size_t elements = 10;
 	preDefinitionHeaders->reserve(elements);
@@ -604,7 +699,8 @@ void ASResource::buildPreDefinitionHeaders(vector<const string*>* preDefinitionH
 	}
 
 	assert(preDefinitionHeaders->size() < elements);
-	sort(preDefinitionHeaders->begin(), preDefinitionHeaders->end(), sortOnName);
+	preDefinitionHeaders->sort(sortOnName);
+	preDefinitionHeaders->buildIndex();
 }
 
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
@@ -613,14 +709,15 @@ void ASResource::buildPreDefinitionHeaders(vector<const string*>* preDefinitionH
 
 // check if a specific line position contains a header.
 const string* ASBase::findHeader(const string& line, int i,
-                                 const vector<const string*>* possibleHeaders) const
+                                 const ASKeywordList* possibleHeaders) const
 {
 	assert(isCharPotentialHeader(line, i));
-	// check the word
-	size_t maxHeaders = possibleHeaders->size();
-	for (size_t p = 0; p < maxHeaders; p++)
+	// check the words beginning with the current character
+	// the vector is sorted so the index is a range of the vector
+	const string* const* headersEnd = possibleHeaders->indexEnd(line[i]);
+	for (const string* const* p = possibleHeaders->indexBegin(line[i]); p != headersEnd; ++p)
 	{
-		const string* header = (*possibleHeaders)[p];
+		const string* header = *p;
 		const size_t wordEnd = i + header->length();
 		if (wordEnd > line.length())
 			continue;
@@ -676,20 +773,20 @@ bool ASBase::findKeyword(const string& line, int i, const string& keyword) const
 
 // check if a specific line position contains an operator.
 const string* ASBase::findOperator(const string& line, int i,
-                                   const vector<const string*>* possibleOperators) const
+                                   const ASKeywordList* possibleOperators) const
 {
 	assert(isCharPotentialOperator(line[i]));
-	// find the operator in the vector
-	// the vector contains the LONGEST operators first
-	// must loop thru the entire vector
-	size_t maxOperators = possibleOperators->size();
-	for (size_t p = 0; p < maxOperators; p++)
+	// find the operator in the operators beginning with the current character
+	// the index contains the LONGEST operators first
+	// must loop thru all of the operators for the character
+	const string* const* operatorsEnd = possibleOperators->indexEnd(line[i]);
+	for (const string* const* p = possibleOperators->indexBegin(line[i]); p != operatorsEnd; ++p)
 	{
-		const size_t wordEnd = i + (*(*possibleOperators)[p]).length();
+		const size_t wordEnd = i + (*p)->length();
 		if (wordEnd > line.length())
 			continue;
-		if (line.compare(i, (*(*possibleOperators)[p]).length(), *(*possibleOperators)[p]) == 0)
-			return (*possibleOperators)[p];
+		if (line.compare(i, (*p)->length(), **p) == 0)
+			return *p;
 	}
 	return nullptr;
 }
@@ -697,6 +794,13 @@ const string* ASBase::findOperator(const string& line, int i,
 // get the current word on a line
 // index must point to the beginning of the word
 string ASBase::getCurrentWord(const string& line, size_t index) const
+{
+	return line.substr(index, getCurrentWordLength(line, index));
+}
+
+// get the length of the current word on a line without copying it
+// index must point to the beginning of the word
+size_t ASBase::getCurrentWordLength(const string& line, size_t index) const
 {
 	assert(isCharPotentialHeader(line, index));
 	size_t lineLength = line.length();
@@ -706,7 +810,7 @@ string ASBase::getCurrentWord(const string& line, size_t index) const
 		if (!isLegalNameChar(line[i]))
 			break;
 	}
-	return line.substr(index, i - index);
+	return i - index;
 }
 
 // check if a specific character can be used in a legal variable/method/class name
@@ -195,6 +195,84 @@ public:
 	virtual string peekNextLine() = 0;
 	virtual void peekReset() = 0;
 	virtual streamoff tellg() = 0;
+
+	// Used by ASFormatter to read the lines without a copy.
+	// The returned line is valid until the next call to either function.
+	// The defaults keep the line returned by nextLine() or peekNextLine().
+	// An iterator that keeps the line in its own buffer may return it.
+	virtual const string& nextLineRef(bool emptyLineWasDeleted)
+	{ lineRefBuffer = nextLine(emptyLineWasDeleted); return lineRefBuffer; }
+	virtual const string& peekNextLineRef()
+	{ lineRefBuffer = peekNextLine(); return lineRefBuffer; }
+
+private:
+	string lineRefBuffer;	// the line returned by the default nextLineRef() and peekNextLineRef()
+};
+
+//-----------------------------------------------------------------------------
+// Class ASPeekCache
+// The lines following the current line that have already been peeked.
+// It is owned by ASFormatter and used by ASPeekStream so that repeated peeks
+// from the same line, or from the following lines, do not read and split the
+// source again. When a line is read from the ASSourceIterator the matching
+// cache line is removed. The number of cached lines is limited to maxLines.
+// The cached lines are kept in [first, last) of a vector. Removed lines keep
+// their memory and are reused when the cache is emptied.
+//-----------------------------------------------------------------------------
+
+class ASPeekCache
+{
+private:
+	struct PeekLine
+	{
+		string line;
+		bool hasMoreLines;		// the source has more lines following this one
+	};
+	vector<PeekLine> lines;
+	size_t first = 0;
+	size_t last = 0;
+
+public:
+	static const size_t maxLines = 1000;
+
+	void clear()
+	{ first = last = 0; }
+
+	size_t size() const
+	{ return last - first; }
+
+	// the returned line is valid until a line is appended
+	const string& getLine(size_t index) const
+	{ return lines[first + index].line; }
+
+	bool hasMoreLinesAfter(size_t index) const
+	{ return lines[first + index].hasMoreLines; }
+
+	void appendLine(const string& line, bool hasMoreLines)
+	{
+		if (size() >= maxLines)
+			return;
+		if (last == lines.size())
+			lines.emplace_back();
+		lines[last].line = line;
+		lines[last].hasMoreLines = hasMoreLines;
+		last++;
+	}
+
+	// the ASSourceIterator has returned the line following the current line
+	void nextLine(const string& line)
+	{
+		if (first == last || lines[first].line != line)
+		{
+			clear();
+			return;
+		}
+		first++;
+		// the lines are reused from the start when the cache is empty,
+		// a cache that is never emptied is cleared to limit its size
+		if (first == last || first >= maxLines)
+			clear();
+	}
 };
 
 //-----------------------------------------------------------------------------
@@ -202,29 +280,130 @@ public:
 // A small class using RAII to peek ahead in the ASSourceIterator stream
 // and to reset the ASSourceIterator pointer in the destructor.
 // It enables a return from anywhere in the method.
+// Lines in the ASPeekCache are returned without reading the ASSourceIterator.
+// The ASSourceIterator is advanced past them only when more lines are needed.
 //-----------------------------------------------------------------------------
 
 class ASPeekStream
 {
 private:
 	ASSourceIterator* sourceIterator;
-	bool needReset;		// reset sourceIterator to the original position
+	ASPeekCache* peekCache;
+	size_t peekCount;		// lines returned by peekNextLine()
+	size_t sourceCount;		// lines peeked from the sourceIterator
+	bool needReset;			// reset sourceIterator to the original position
 
 public:
-	explicit ASPeekStream(ASSourceIterator* sourceIterator_)
-	{ sourceIterator = sourceIterator_; needReset = false; }
+	ASPeekStream(ASSourceIterator* sourceIterator_, ASPeekCache* peekCache_)
+	{
+		sourceIterator = sourceIterator_;
+		peekCache = peekCache_;
+		peekCount = sourceCount = 0;
+		needReset = false;
+	}
 
 	~ASPeekStream()
 	{ if (needReset) sourceIterator->peekReset(); }
 
 	bool hasMoreLines() const
-	{ return sourceIterator->hasMoreLines(); }
+	{
+		if (sourceCount == peekCount)
+			return sourceIterator->hasMoreLines();
+		return peekCache->hasMoreLinesAfter(peekCount - 1);
+	}
 
-	string peekNextLine()
-	{ needReset = true; return sourceIterator->peekNextLine(); }
+	// the returned line is valid until the next call
+	const string& peekNextLine()
+	{
+		if (peekCount < peekCache->size())
+			return peekCache->getLine(peekCount++);
+		needReset = true;
+		while (sourceCount < peekCount)
+		{
+			sourceIterator->peekNextLineRef();
+			sourceCount++;
+		}
+		const string& nextLine_ = sourceIterator->peekNextLineRef();
+		if (peekCount++ == peekCache->size())
+			peekCache->appendLine(nextLine_, sourceIterator->hasMoreLines());
+		sourceCount++;
+		return nextLine_;
+	}
 };
 
 
+//-----------------------------------------------------------------------------
+// Class ASKeywordList
+// A vector of keywords indexed by the first character of the keyword.
+// The keywords keep their vector order within each character so a search
+// of the index gives the same result as a search of the entire vector.
+// The vector is read only except for the members used to build the list.
+// These invalidate the index until it is rebuilt by buildIndex().
+//-----------------------------------------------------------------------------
+
+class ASKeywordList
+{
+public:
+	typedef vector<const string*>::const_iterator const_iterator;
+
+	// read only access to the keywords
+	const_iterator begin() const { return keywords.begin(); }
+	const_iterator end() const { return keywords.end(); }
+	const string* operator[](size_t i) const { return keywords[i]; }
+	size_t size() const { return keywords.size(); }
+	bool empty() const { return keywords.empty(); }
+
+	// build the list
+	void reserve(size_t elements) { keywords.reserve(elements); }
+	void emplace_back(const string* keyword) { keywords.emplace_back(keyword); isIndexed = false; }
+	void sort(bool (*compare)(const string*, const string*));
+	void buildIndex();
+
+	// the indexed keywords beginning with a character
+	const string* const* indexBegin(char ch) const
+	{ assert(isIndexed); return indexedKeywords.data() + charStart[(unsigned char) ch]; }
+	const string* const* indexEnd(char ch) const
+	{ assert(isIndexed); return indexedKeywords.data() + charStart[(unsigned char) ch + 1]; }
+
+private:
+	vector<const string*> keywords;
+	vector<const string*> indexedKeywords;  // keywords sorted by first character
+	unsigned short charStart[257] = { };    // start of each character in indexedKeywords
+	bool isIndexed = false;                 // the index matches the keywords
+};
+
+//-----------------------------------------------------------------------------
+// Struct ASKeywordTables
+// The keyword lists for one file type. They are built once when first
+// requested by ASResource::getKeywordTables() and are shared, read only,
+// by all ASFormatter, ASBeautifier, and ASEnhancer objects.
+//-----------------------------------------------------------------------------
+
+struct ASKeywordTables
+{
+	explicit ASKeywordTables(int fileType);
+	ASKeywordTables(const ASKeywordTables&)            = delete;
+	ASKeywordTables& operator=(ASKeywordTables const&) = delete;
+
+	// used by ASFormatter
+	ASKeywordList headers;
+	ASKeywordList nonParenHeaders;
+	ASKeywordList preDefinitionHeaders;
+	ASKeywordList operators;
+	ASKeywordList castOperators;
+	// used by ASBeautifier
+	ASKeywordList beautifierHeaders;
+	ASKeywordList beautifierNonParenHeaders;
+	ASKeywordList nonAssignmentOperators;
+	ASKeywordList preBlockStatements;
+	ASKeywordList indentableHeaders;
+	// used by both ASFormatter and ASBeautifier
+	ASKeywordList assignmentOperators;
+	ASKeywordList preCommandHeaders;
+	// used by ASEnhancer
+	vector<const pair<const string, const string>* > indentableMacros;
+};
+
 //-----------------------------------------------------------------------------
 // Class ASResource
 //-----------------------------------------------------------------------------
@@ -232,17 +411,18 @@ public:
 class ASResource
 {
 public:
-	void buildAssignmentOperators(vector<const string*>* assignmentOperators);
-	void buildCastOperators(vector<const string*>* castOperators);
-	void buildHeaders(vector<const string*>* headers, int fileType, bool beautifier = false);
-	void buildIndentableMacros(vector<const pair<const string, const string>* >* indentableMacros);
-	void buildIndentableHeaders(vector<const string*>* indentableHeaders);
-	void buildNonAssignmentOperators(vector<const string*>* nonAssignmentOperators);
-	void buildNonParenHeaders(vector<const string*>* nonParenHeaders, int fileType, bool beautifier = false);
-	void buildOperators(vector<const string*>* operators, int fileType);
-	void buildPreBlockStatements(vector<const string*>* preBlockStatements, int fileType);
-	void buildPreCommandHeaders(vector<const string*>* preCommandHeaders, int fileType);
-	void buildPreDefinitionHeaders(vector<const string*>* preDefinitionHeaders, int fileType);
+	static void buildAssignmentOperators(ASKeywordList* assignmentOperators);
+	static void buildCastOperators(ASKeywordList* castOperators);
+	static void buildHeaders(ASKeywordList* headers, int fileType, bool beautifier = false);
+	static void buildIndentableMacros(vector<const pair<const string, const string>* >* indentableMacros);
+	static void buildIndentableHeaders(ASKeywordList* indentableHeaders);
+	static void buildNonAssignmentOperators(ASKeywordList* nonAssignmentOperators);
+	static void buildNonParenHeaders(ASKeywordList* nonParenHeaders, int fileType, bool beautifier = false);
+	static void buildOperators(ASKeywordList* operators, int fileType);
+	static void buildPreBlockStatements(ASKeywordList* preBlockStatements, int fileType);
+	static void buildPreCommandHeaders(ASKeywordList* preCommandHeaders, int fileType);
+	static void buildPreDefinitionHeaders(ASKeywordList* preDefinitionHeaders, int fileType);
+	static const ASKeywordTables* getKeywordTables(int fileType);
 
 public:
 	static const string AS_IF, AS_ELSE;
@@ -311,11 +491,12 @@ protected:  // inline functions
 
 protected:  // functions definitions are at the end of ASResource.cpp
 	const string* findHeader(const string& line, int i,
-	                         const vector<const string*>* possibleHeaders) const;
+	                         const ASKeywordList* possibleHeaders) const;
 	bool findKeyword(const string& line, int i, const string& keyword) const;
 	const string* findOperator(const string& line, int i,
-	                           const vector<const string*>* possibleOperators) const;
+	                           const ASKeywordList* possibleOperators) const;
 	string getCurrentWord(const string& line, size_t index) const;
+	size_t getCurrentWordLength(const string& line, size_t index) const;
 	bool isDigit(char ch) const;
 	bool isLegalNameChar(char ch) const;
 	bool isCharPotentialHeader(const string& line, size_t i) const;
@@ -341,6 +522,7 @@ public:
 	virtual void init(ASSourceIterator* iter);
 
 	virtual string beautify(const string& originalLine);
+	void beautify(const string& originalLine, string& indentedLine);
 	void setCaseIndent(bool state);
 	void setClassIndent(bool state);
 	void setContinuationIndentation(int indent = 1);
@@ -385,7 +567,6 @@ public:
 	bool getSwitchIndent() const;
 
 protected:
-	void deleteBeautifierVectors();
 	int  getNextProgramCharDistance(const string& line, int i) const;
 	int  indexOf(const vector<const string*>& container, const string* element) const;
 	void setBlockIndent(bool state);
@@ -393,6 +574,7 @@ protected:
 	void setBraceIndentVtk(bool state);
 	string extractPreprocessorStatement(const string& line) const;
 	string trim(const string& str) const;
+	void trim(const string& str, string& trimmedStr) const;
 	string rtrim(const string& str) const;
 
 	// variables set by ASFormatter - must be updated in activeBeautifierStack
@@ -423,9 +605,10 @@ private:  // functions
 	                                int tabIncrementIn, int minIndent, bool updateParenStack);
 	void registerContinuationIndentColon(const string& line, int i, int tabIncrementIn);
 	void initVectors();
-	void initTempStacksContainer(vector<vector<const string*>*>*& container,
-	                             vector<vector<const string*>*>* value);
+	void initBeautifierContainer(vector<ASBeautifier*>*& container);
+	void initTempStacksContainer(vector<vector<const string*>*>*& container);
 	void clearObjCMethodDefinitionAlignment();
+	void copyBeautifierState(const ASBeautifier& other);
 	void deleteBeautifierContainer(vector<ASBeautifier*>*& container);
 	void deleteTempStacksContainer(vector<vector<const string*>*>*& container);
 	int  adjustIndentCountForBreakElseIfComments() const;
@@ -441,30 +624,37 @@ private:  // functions
 	bool isInPreprocessorUnterminatedComment(const string& line);
 	bool isTopLevel() const;
 	bool statementEndsWithComma(const string& line, int index) const;
-	const string& getIndentedLineReturn(const string& newLine, const string& originalLine) const;
 	string getIndentedSpaceEquivalent(const string& line_) const;
-	string preLineWS(int lineIndentCount, int lineSpaceIndentCount) const;
+	void preLineWS(string& ws, int lineIndentCount, int lineSpaceIndentCount) const;
+	void setIndentedLine(string& indentedLine, const string& line, const string& originalLine,
+	                     int lineIndentCount, int lineSpaceIndentCount) const;
 	template<typename T> void deleteContainer(T& container);
-	template<typename T> void initContainer(T& container, T value);
-	vector<vector<const string*>*>* copyTempStacks(const ASBeautifier& other) const;
+	template<typename T> void initContainer(vector<T>*& container);
+	void copyTempStacks(const ASBeautifier& other);
 	pair<int, int> computePreprocessorIndent();
+	ASBeautifier* cloneBeautifier(const ASBeautifier& other);
+	void recycleBeautifier(ASBeautifier* beautifier);
+	vector<const string*>* newTempStack();
+	void recycleTempStack(vector<const string*>* tempStack);
 
 private:  // variables
 	int beautifierFileType;
-	vector<const string*>* headers;
-	vector<const string*>* nonParenHeaders;
-	vector<const string*>* preBlockStatements;
-	vector<const string*>* preCommandHeaders;
-	vector<const string*>* assignmentOperators;
-	vector<const string*>* nonAssignmentOperators;
-	vector<const string*>* indentableHeaders;
+	const ASKeywordList* headers;
+	const ASKeywordList* nonParenHeaders;
+	const ASKeywordList* preBlockStatements;
+	const ASKeywordList* preCommandHeaders;
+	const ASKeywordList* assignmentOperators;
+	const ASKeywordList* nonAssignmentOperators;
+	const ASKeywordList* indentableHeaders;
 
 	vector<ASBeautifier*>* waitingBeautifierStack;
 	vector<ASBeautifier*>* activeBeautifierStack;
 	vector<size_t>* waitingBeautifierStackLengthStack;
 	vector<size_t>* activeBeautifierStackLengthStack;
+	vector<ASBeautifier*>* beautifierPool;		// deleted clones to be reused
 	vector<const string*>* headerStack;
 	vector<vector<const string*>* >* tempStacks;
+	vector<vector<const string*>* >* tempStacksPool;	// for reuse by newTempStack()
 	vector<int>* parenDepthStack;
 	vector<bool>* blockStatementStack;
 	vector<bool>* parenStatementStack;
@@ -481,6 +671,7 @@ private:  // variables
 	const string* lastLineHeader;
 	string indentString;
 	string verbatimDelimiter;
+	string trimmedLine;		// the line being beautified, reused for each line
 	bool isInQuote;
 	bool isInVerbatimQuote;
 	bool haveLineContinuationChar;
@@ -551,6 +742,8 @@ private:  // variables
 	int  spaceIndentObjCMethodAlignment;
 	int  bracePosObjCMethodAlignment;
 	int  colonIndentObjCMethodAlignment;
+	int  keywordIndentObjCMethodAlignment;
+	int  preprocessorCppExternCBrace;	// extern "C" in a #if __cplusplus, shared with the active clone
 	int  lineOpeningBlocksNum;
 	int  lineClosingBlocksNum;
 	int  fileType;
@@ -585,7 +778,7 @@ class ASEnhancer : protected ASBase
 public:  // functions
 	ASEnhancer() = default;
 	void init(int, int, int, bool, bool, bool, bool, bool, bool, bool,
-	          vector<const pair<const string, const string>* >*);
+	          const vector<const pair<const string, const string>* >*);
 	void enhance(string& line, bool isInNamespace, bool isInPreprocessor, bool isInSQL);
 
 private:  // functions
@@ -595,6 +788,7 @@ private:  // functions
 	int    indentLine(string&  line, int indent) const;
 	bool   isBeginDeclareSectionSQL(const string&  line, size_t index) const;
 	bool   isEndDeclareSectionSQL(const string&  line, size_t index) const;
+	bool   isKeywordCheckNeeded(const string& line, bool isInSQL) const;
 	bool   isOneLineBlockReached(const string& line, int startChar) const;
 	void   parseCurrentLine(string& line, bool isInPreprocessor, bool isInSQL);
 	size_t processSwitchBlock(string&  line, size_t index);
@@ -619,7 +813,6 @@ private:
 	char quoteChar;
 
 	// unindent variables
-	int  braceCount;
 	int  switchDepth;
 	int  eventPreprocDepth;
 	bool lookingForCaseBrace;
@@ -642,7 +835,7 @@ private:
 	// event table variables
 	bool nextLineIsEventIndent;             // begin event table indent is reached
 	bool isInEventTable;                    // need to indent an event table
-	vector<const pair<const string, const string>* >* indentableMacros;
+	const vector<const pair<const string, const string>* >* indentableMacros;
 
 	// SQL variables
 	bool nextLineIsDeclareIndent;           // begin declare section indent is reached
@@ -666,7 +859,7 @@ public:	// functions
 	void init(ASSourceIterator* si) override;
 
 	bool hasMoreLines() const;
-	string nextLine();
+	const string& nextLine();		// valid until the next call
 	LineEndFormat getLineEndFormat() const;
 	bool getIsLineReady() const;
 	void setFormattingStyle(FormatStyle style);
@@ -730,7 +923,7 @@ public:	// functions
 
 private:  // functions
 	template<typename T> void deleteContainer(T& container);
-	template<typename T> void initContainer(T& container, T value);
+	template<typename T> void initContainer(vector<T>*& container);
 	char peekNextChar() const;
 	BraceType getBraceType();
 	bool adjustChecksumIn(int adjustment);
@@ -784,6 +977,7 @@ private:  // functions
 	void appendChar(char ch, bool canBreakLine);
 	void appendCharInsideComments();
 	void appendClosingHeader();
+	void appendCommentText(size_t textEnd);
 	void appendOperator(const string& sequence, bool canBreakLine = true);
 	void appendSequence(const string& sequence, bool canBreakLine = true);
 	void appendSpacePad();
@@ -817,7 +1011,7 @@ private:  // functions
 	void fixOptionVariableConflicts();
 	void goForward(int i);
 	void isLineBreakBeforeClosingHeader();
-	void initContainer(vector<BraceType>*& container, vector<BraceType>* value);
+	void initContainer(vector<BraceType>*& container);
 	void initNewLine();
 	void padObjCMethodColon();
 	void padObjCMethodPrefix();
@@ -839,20 +1033,25 @@ private:  // functions
 	string getPreviousWord(const string& line, int currPos) const;
 	string peekNextText(const string& firstLine,
 	                    bool endOnEmptyLine = false,
-	                    const shared_ptr<ASPeekStream>& streamArg = nullptr) const;
+	                    ASPeekStream* streamArg = nullptr) const;
+	char peekNextTextChar(size_t startChar) const;
+	size_t findNextText(const string& firstLine, size_t firstLineStart,
+	                    bool endOnEmptyLine, ASPeekStream& stream,
+	                    const string*& textLine) const;
 
 private:  // variables
 	int formatterFileType;
-	vector<const string*>* headers;
-	vector<const string*>* nonParenHeaders;
-	vector<const string*>* preDefinitionHeaders;
-	vector<const string*>* preCommandHeaders;
-	vector<const string*>* operators;
-	vector<const string*>* assignmentOperators;
-	vector<const string*>* castOperators;
-	vector<const pair<const string, const string>* >* indentableMacros;	// for ASEnhancer
+	const ASKeywordList* headers;
+	const ASKeywordList* nonParenHeaders;
+	const ASKeywordList* preDefinitionHeaders;
+	const ASKeywordList* preCommandHeaders;
+	const ASKeywordList* operators;
+	const ASKeywordList* assignmentOperators;
+	const ASKeywordList* castOperators;
+	const vector<const pair<const string, const string>* >* indentableMacros;	// for ASEnhancer
 
 	ASSourceIterator* sourceIterator;
+	mutable ASPeekCache peekCache;
 	ASEnhancer* enhancer;
 
 	vector<const string*>* preBraceHeaderStack;
@@ -864,6 +1063,8 @@ private:  // variables
 	string currentLine;
 	string formattedLine;
 	string readyFormattedLine;
+	string beautifiedLineBuf;	// returned by nextLine(), reused for each line
+	string currentName;			// the name being appended by nextLine()
 	string verbatimDelimiter;
 	const string* currentHeader;
 	char currentChar;
@@ -904,7 +1105,6 @@ private:  // variables
 	size_t maxParenPending;
 	size_t maxWhiteSpacePending;
 
-	size_t previousReadyFormattedLineLength;
 	FormatStyle formattingStyle;
 	BraceMode braceFormatMode;
 	BraceType previousBraceType;
@@ -1048,6 +1248,7 @@ private:  // variables
 	bool isIndentableProprocessor;
 	bool isIndentableProprocessorBlock;
 	bool prependEmptyLine;
+	bool previousReadyFormattedLineIsEmpty;
 	bool appendOpeningBrace;
 	bool foundClosingHeader;
 	bool isInHeader;
@@ -1067,11 +1268,11 @@ private:  // inline functions
 	{ return currentLine.compare(charNum, strlen(sequence), sequence) == 0; }
 
 	// call ASBase::findHeader for the current character
-	const string* findHeader(const vector<const string*>* headers_)
+	const string* findHeader(const ASKeywordList* headers_)
 	{ return ASBase::findHeader(currentLine, charNum, headers_); }
 
 	// call ASBase::findOperator for the current character
-	const string* findOperator(const vector<const string*>* operators_)
+	const string* findOperator(const ASKeywordList* operators_)
 	{ return ASBase::findOperator(currentLine, charNum, operators_); }
 };  // Class ASFormatter
 
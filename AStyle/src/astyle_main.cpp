@@ -9,13 +9,21 @@
  *   They are arranged as follows.
  *   ---------------------------------------
  *   namespace astyle {
+ *   ASLineIterator methods
  *   ASStreamIterator methods
+ *   ASBufferIterator methods
+ *   ASStreamingIterator methods
+ *   ASMappedFile methods
+ *   ASFileCache methods
+ *   ASFileQueue methods
+ *   ASExcludeMatcher methods
  *   ASConsole methods
  *      // Windows specific
  *      // Linux specific
  *   ASLibrary methods
  *      // Windows specific
  *      // Linux specific
+ *   ASLibraryFormatter methods
  *   ASOptions methods
  *   ASEncoding methods
  *   }  // end of astyle namespace
@@ -24,6 +32,7 @@
  *      AStyleMainUtf16 entry point
  *      AStyleMain entry point
  *      AStyleGetVersion entry point
+ *      AStyleCreate, AStyleFormat, AStyleDestroy entry points
  *      main entry point
  *  ---------------------------------------
  * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *
@@ -38,16 +47,22 @@
 #include <algorithm>
 #include <cerrno>
 #include <clocale>		// needed by some compilers
+#include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <sstream>
+#include <thread>
 
 // includes for recursive getFileNames() function
 #ifdef _WIN32
 	#undef UNICODE		// use ASCII windows functions
 	#include <Windows.h>
+	#include <io.h>
 #else
 	#include <dirent.h>
+	#include <fcntl.h>
+	#include <sys/mman.h>
 	#include <sys/stat.h>
 	#include <unistd.h>
 	#ifdef __VMS
@@ -76,36 +91,30 @@
 
 namespace astyle {
 //
-// console build variables
+// console build constants
+// they are const so that files can be formatted concurrently
 #ifndef ASTYLE_LIB
+	extern const char g_fileSeparator;
+	extern const bool g_isCaseSensitive;
 	#ifdef _WIN32
-		char g_fileSeparator = '\\';     // Windows file separator
-		bool g_isCaseSensitive = false;  // Windows IS NOT case sensitive
+		const char g_fileSeparator = '\\';     // Windows file separator
+		const bool g_isCaseSensitive = false;  // Windows IS NOT case sensitive
 	#else
-		char g_fileSeparator = '/';      // Linux file separator
-		bool g_isCaseSensitive = true;   // Linux IS case sensitive
+		const char g_fileSeparator = '/';      // Linux file separator
+		const bool g_isCaseSensitive = true;   // Linux IS case sensitive
 	#endif	// _WIN32
 #endif	// ASTYLE_LIB
 
-// java library build variables
-#ifdef ASTYLE_JNI
-	JNIEnv*   g_env;
-	jobject   g_obj;
-	jmethodID g_mid;
-#endif
-
 const char* g_version = "3.2 beta";
 
 //-----------------------------------------------------------------------------
-// ASStreamIterator class
-// typename will be stringstream for AStyle
-// it could be istream or wxChar for plug-ins
+// ASLineIterator class
+// the line ends and the peek position for the iterators below
+// the input is read by the derived class
 //-----------------------------------------------------------------------------
 
-template<typename T>
-ASStreamIterator<T>::ASStreamIterator(T* in)
+ASLineIterator::ASLineIterator()
 {
-	inStream = in;
 	buffer.reserve(200);
 	eolWindows = 0;
 	eolLinux = 0;
@@ -113,35 +122,18 @@ ASStreamIterator<T>::ASStreamIterator(T* in)
 	peekStart = 0;
 	prevLineDeleted = false;
 	checkForEmptyLine = false;
-	// get length of stream
-	inStream->seekg(0, inStream->end);
-	streamLength = inStream->tellg();
-	inStream->seekg(0, inStream->beg);
 }
 
-template<typename T>
-ASStreamIterator<T>::~ASStreamIterator() = default;
-
-/**
-* get the length of the input stream.
-* streamLength variable is set by the constructor.
-*
-* @return     length of the input file stream, converted to an int.
-*/
-template<typename T>
-int ASStreamIterator<T>::getStreamLength() const
-{
-	return static_cast<int>(streamLength);
-}
+ASLineIterator::~ASLineIterator() = default;
 
 /**
- * read the input stream, delete any end of line characters,
+ * read the input, delete any end of line characters,
  *     and build a string that contains the input line.
  *
- * @return        string containing the next input line minus any end of line characters
+ * @return        the next input line minus any end of line characters,
+ *                valid until the next call to nextLineRef() or peekNextLineRef()
  */
-template<typename T>
-string ASStreamIterator<T>::nextLine(bool emptyLineWasDeleted)
+const string& ASLineIterator::nextLineRef(bool emptyLineWasDeleted)
 {
 	// verify that the current position is correct
 	assert(peekStart == 0);
@@ -153,37 +145,28 @@ string ASStreamIterator<T>::nextLine(bool emptyLineWasDeleted)
 		prevLineDeleted = false;
 		checkForEmptyLine = true;
 	}
+	// the buffers are swapped to keep their memory
 	if (!emptyLineWasDeleted)
-		prevBuffer = buffer;
+		prevBuffer.swap(buffer);
 	else
 		prevLineDeleted = true;
 
 	// read the next record
 	buffer.clear();
 	char ch;
-	inStream->get(ch);
-
-	while (!inStream->eof() && ch != '\n' && ch != '\r')
-	{
-		buffer.append(1, ch);
-		inStream->get(ch);
-	}
-
-	if (inStream->eof())
-	{
+	if (!readLine(buffer, ch))
 		return buffer;
-	}
-
-	int peekCh = inStream->peek();
 
 	// find input end-of-line characters
-	if (!inStream->eof())
+	// an end of line at the end of the input is not counted
+	int peekCh = peekChar();
+	if (peekCh != EOF)
 	{
 		if (ch == '\r')         // CR+LF is windows otherwise Mac OS 9
 		{
 			if (peekCh == '\n')
 			{
-				inStream->get();
+				skipChar();
 				eolWindows++;
 			}
 			else
@@ -193,17 +176,13 @@ string ASStreamIterator<T>::nextLine(bool emptyLineWasDeleted)
 		{
 			if (peekCh == '\r')
 			{
-				inStream->get();
+				skipChar();
 				eolWindows++;
 			}
 			else
 				eolLinux++;
 		}
 	}
-	else
-	{
-		inStream->clear();
-	}
 
 	// has not detected an input end of line
 	if (!eolWindows && !eolLinux && !eolMacOld)
@@ -234,70 +213,49 @@ string ASStreamIterator<T>::nextLine(bool emptyLineWasDeleted)
 // save the current position and get the next line
 // this can be called for multiple reads
 // when finished peeking you MUST call peekReset()
+// the line is valid until the next call to nextLineRef() or peekNextLineRef()
 // call this function from ASFormatter ONLY
-template<typename T>
-string ASStreamIterator<T>::peekNextLine()
+const string& ASLineIterator::peekNextLineRef()
 {
 	assert(hasMoreLines());
-	string nextLine_;
-	char ch;
 
 	if (!peekStart)
-		peekStart = inStream->tellg();
+		peekStart = tellg();
 
 	// read the next record
-	inStream->get(ch);
-	while (!inStream->eof() && ch != '\n' && ch != '\r')
-	{
-		nextLine_.append(1, ch);
-		inStream->get(ch);
-	}
-
-	if (inStream->eof())
-	{
-		return nextLine_;
-	}
-
-	int peekCh = inStream->peek();
+	peekBuffer.clear();
+	char ch;
+	if (!readLine(peekBuffer, ch))
+		return peekBuffer;
 
 	// remove end-of-line characters
-	if (!inStream->eof())
-	{
-		if ((peekCh == '\n' || peekCh == '\r') && peekCh != ch)
-			inStream->get();
-	}
-
-	return nextLine_;
+	// the end of the input is found after the end of line, as by istream peek()
+	int peekCh = peekChar();
+	if (peekCh == EOF)
+		setEndOfInput();
+	else if ((peekCh == '\n' || peekCh == '\r') && peekCh != ch)
+		skipChar();
+
+	return peekBuffer;
 }
 
 // reset current position and EOF for peekNextLine()
-template<typename T>
-void ASStreamIterator<T>::peekReset()
+void ASLineIterator::peekReset()
 {
 	assert(peekStart != 0);
-	inStream->clear();
-	inStream->seekg(peekStart);
+	seekPeekStart(peekStart);
 	peekStart = 0;
 }
 
 // save the last input line after input has reached EOF
-template<typename T>
-void ASStreamIterator<T>::saveLastInputLine()
+void ASLineIterator::saveLastInputLine()
 {
-	assert(inStream->eof());
+	assert(!hasMoreLines());
 	prevBuffer = buffer;
 }
 
-// return position of the get pointer
-template<typename T>
-streamoff ASStreamIterator<T>::tellg()
-{
-	return inStream->tellg();
-}
-
 // check for a change in line ends
-template<typename T>
-bool ASStreamIterator<T>::getLineEndChange(int lineEndFormat) const
+bool ASLineIterator::getLineEndChange(int lineEndFormat) const
 {
 	assert(lineEndFormat == LINEEND_DEFAULT
 	       || lineEndFormat == LINEEND_WINDOWS
@@ -320,7 +278,872 @@ bool ASStreamIterator<T>::getLineEndChange(int lineEndFormat) const
 		else if (eolMacOld > 0)
 			lineEndChange = (eolWindows + eolLinux != 0);
 	}
-	return lineEndChange;
+	return lineEndChange;
+}
+
+//-----------------------------------------------------------------------------
+// ASStreamIterator class
+// typename will be stringstream for AStyle
+// it could be istream or wxChar for plug-ins
+//-----------------------------------------------------------------------------
+
+template<typename T>
+ASStreamIterator<T>::ASStreamIterator(T* in)
+{
+	inStream = in;
+	// get length of stream
+	inStream->seekg(0, inStream->end);
+	streamLength = inStream->tellg();
+	inStream->seekg(0, inStream->beg);
+}
+
+template<typename T>
+ASStreamIterator<T>::~ASStreamIterator() = default;
+
+/**
+* get the length of the input stream.
+* streamLength variable is set by the constructor.
+*
+* @return     length of the input file stream, converted to an int.
+*/
+template<typename T>
+int ASStreamIterator<T>::getStreamLength() const
+{
+	return static_cast<int>(streamLength);
+}
+
+// return the next character without reading it, or EOF at the end of the stream
+// the stream eof() is not set, it is set by setEndOfInput()
+template<typename T>
+int ASStreamIterator<T>::peekChar()
+{
+	int peekCh = inStream->peek();
+	if (inStream->eof())
+	{
+		inStream->clear();
+		return EOF;
+	}
+	return peekCh;
+}
+
+/**
+ * Append the characters to the end of line to line.
+ *
+ * @param line        the string for the characters.
+ * @param lineEndCh   set to the CR or LF that ended the line.
+ * @return            false if the stream ended before an end of line.
+ */
+template<typename T>
+bool ASStreamIterator<T>::readLine(string& line, char& lineEndCh)
+{
+	char ch;
+	inStream->get(ch);
+	while (!inStream->eof() && ch != '\n' && ch != '\r')
+	{
+		line.append(1, ch);
+		inStream->get(ch);
+	}
+	if (inStream->eof())
+		return false;
+	lineEndCh = ch;
+	return true;
+}
+
+// return to a position saved by peekNextLine()
+template<typename T>
+void ASStreamIterator<T>::seekPeekStart(streamoff pos)
+{
+	inStream->clear();
+	inStream->seekg(pos);
+}
+
+// set eof() after the last end of line has been peeked
+template<typename T>
+void ASStreamIterator<T>::setEndOfInput()
+{
+	inStream->setstate(ios::eofbit);
+}
+
+// skip the second character of a CR+LF or LF+CR end of line
+template<typename T>
+void ASStreamIterator<T>::skipChar()
+{
+	inStream->get();
+}
+
+// return position of the get pointer
+template<typename T>
+streamoff ASStreamIterator<T>::tellg()
+{
+	return inStream->tellg();
+}
+
+// the stringstream iterator is used by the console and the test programs
+template class ASStreamIterator<stringstream>;
+
+//-----------------------------------------------------------------------------
+// ASBufferIterator class
+// used by AStyle for input that is already in memory
+// the lines are found with memchr instead of reading a character at a time
+//-----------------------------------------------------------------------------
+
+ASBufferIterator::ASBufferIterator(const char* data, size_t dataLength)
+{
+	inData = data;
+	inLength = dataLength;
+	inPos = 0;
+	isEof = false;
+	lfSearchStart = string::npos;
+	lfPos = string::npos;
+}
+
+ASBufferIterator::~ASBufferIterator() = default;
+
+/**
+* get the length of the input data.
+*
+* @return     length of the input data, converted to an int.
+*/
+int ASBufferIterator::getStreamLength() const
+{
+	return static_cast<int>(inLength);
+}
+
+/**
+ * Find the end of line character that ends the line starting at lineStart.
+ * The LF found by a previous search is reused if no LF can occur before it.
+ * Otherwise a file with only CR line ends would be searched to the end for
+ * every line. The CR search stops at the LF.
+ *
+ * @param lineStart   offset of the start of the line.
+ * @return            offset of the first CR or LF, or string::npos if none.
+ */
+size_t ASBufferIterator::findLineEnd(size_t lineStart)
+{
+	if (lfPos < lineStart)
+	{
+		lfSearchStart = lineStart;
+		const void* lf = memchr(inData + lineStart, '\n', inLength - lineStart);
+		lfPos = (lf != nullptr) ? static_cast<const char*>(lf) - inData : string::npos;
+	}
+	else if (lineStart < lfSearchStart)
+	{
+		// search only the text before the previous search
+		size_t searchEnd = min(lfSearchStart, inLength);
+		const void* lf = memchr(inData + lineStart, '\n', searchEnd - lineStart);
+		if (lf != nullptr)
+			lfPos = static_cast<const char*>(lf) - inData;
+		lfSearchStart = lineStart;
+	}
+	size_t crSearchEnd = (lfPos != string::npos) ? lfPos : inLength;
+	const void* cr = memchr(inData + lineStart, '\r', crSearchEnd - lineStart);
+	if (cr != nullptr)
+		return static_cast<const char*>(cr) - inData;
+	return lfPos;
+}
+
+// return the next character without reading it, or EOF at the end of the data
+int ASBufferIterator::peekChar()
+{
+	if (inPos >= inLength)
+		return EOF;
+	return static_cast<unsigned char>(inData[inPos]);
+}
+
+/**
+ * Append the characters to the end of line to line.
+ *
+ * @param line        the string for the characters.
+ * @param lineEndCh   set to the CR or LF that ended the line.
+ * @return            false if the data ended before an end of line.
+ */
+bool ASBufferIterator::readLine(string& line, char& lineEndCh)
+{
+	size_t lineEnd = (inPos < inLength) ? findLineEnd(inPos) : string::npos;
+	if (lineEnd == string::npos)
+	{
+		if (inPos < inLength)
+			line.assign(inData + inPos, inLength - inPos);
+		inPos = inLength;
+		isEof = true;
+		return false;
+	}
+	line.assign(inData + inPos, lineEnd - inPos);
+	lineEndCh = inData[lineEnd];
+	inPos = lineEnd + 1;
+	return true;
+}
+
+// return to a position saved by peekNextLine()
+void ASBufferIterator::seekPeekStart(streamoff pos)
+{
+	isEof = false;
+	inPos = static_cast<size_t>(pos);
+}
+
+// set the end of data after the last end of line has been peeked
+void ASBufferIterator::setEndOfInput()
+{
+	isEof = true;
+}
+
+// skip the second character of a CR+LF or LF+CR end of line
+void ASBufferIterator::skipChar()
+{
+	inPos++;
+}
+
+// return position of the next character, or -1 at the end of data
+// the same as istream tellg() which fails if eof() is set
+streamoff ASBufferIterator::tellg()
+{
+	if (isEof)
+		return -1;
+	return static_cast<streamoff>(inPos);
+}
+
+//-----------------------------------------------------------------------------
+// ASStreamingIterator class
+// used by AStyle for input from stdin
+// the input is read in blocks as it arrives and the lines are found with memchr
+//-----------------------------------------------------------------------------
+
+#ifndef ASTYLE_LIB
+
+ASStreamingIterator::ASStreamingIterator(int fileDescriptor)
+{
+	inFd = fileDescriptor;
+	isInputEnded = false;
+	isReadError = false;
+	windowPos = 0;
+	windowStart = 0;
+	isEof = false;
+}
+
+ASStreamingIterator::~ASStreamingIterator() = default;
+
+/**
+* get the length of the input that has been read.
+* this is the length of the input stream after the end has been reached.
+*
+* @return     length of the input, converted to an int.
+*/
+int ASStreamingIterator::getStreamLength() const
+{
+	return static_cast<int>(windowStart + static_cast<streamoff>(window.length()));
+}
+
+/**
+ * Read the next block of input into the window.
+ * A read may return less than a block if that is all that is available.
+ *
+ * @return        true if input was read, false at the end of the input.
+ */
+bool ASStreamingIterator::readMore()
+{
+	const size_t blockSize = 65536;	// 64 KB
+	if (isInputEnded)
+		return false;
+	size_t oldLength = window.length();
+	window.resize(oldLength + blockSize);
+#ifdef _WIN32
+	int bytesRead = _read(inFd, &window[oldLength], blockSize);
+#else
+	ssize_t bytesRead;
+	do
+		bytesRead = read(inFd, &window[oldLength], blockSize);
+	while (bytesRead < 0 && errno == EINTR);
+#endif
+	window.resize(oldLength + (bytesRead > 0 ? static_cast<size_t>(bytesRead) : 0));
+	if (bytesRead <= 0)
+	{
+		isInputEnded = true;
+		isReadError = (bytesRead < 0);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Check that the window contains the character at pos,
+ * reading more input if it is needed.
+ *
+ * @param pos     offset in the window.
+ * @return        true if the character is available.
+ */
+bool ASStreamingIterator::hasData(size_t pos)
+{
+	while (pos >= window.length())
+	{
+		if (!readMore())
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Find the end of line character that ends the line starting at lineStart.
+ * The CR search stops at the first LF so the window is not searched to the end
+ * for every line. More input is read until a line end or the end of input.
+ *
+ * @param lineStart   offset in the window of the start of the line.
+ * @return            offset of the first CR or LF, or string::npos if none.
+ */
+size_t ASStreamingIterator::findLineEnd(size_t lineStart)
+{
+	size_t searchStart = lineStart;
+	while (true)
+	{
+		const char* data = window.data();
+		size_t searchLength = window.length() - searchStart;
+		const void* lf = memchr(data + searchStart, '\n', searchLength);
+		size_t crSearchLength = (lf != nullptr)
+		                        ? static_cast<const char*>(lf) - (data + searchStart)
+		                        : searchLength;
+		const void* cr = memchr(data + searchStart, '\r', crSearchLength);
+		if (cr != nullptr)
+			return static_cast<const char*>(cr) - data;
+		if (lf != nullptr)
+			return static_cast<const char*>(lf) - data;
+		searchStart = window.length();
+		if (!readMore())
+			return string::npos;
+	}
+}
+
+// return the next character without reading it, or EOF at the end of the input
+int ASStreamingIterator::peekChar()
+{
+	if (!hasData(windowPos))
+		return EOF;
+	return static_cast<unsigned char>(window[windowPos]);
+}
+
+/**
+ * Append the characters to the end of line to line.
+ * The input that has been read is discarded unless a line is being peeked.
+ *
+ * @param line        the string for the characters.
+ * @param lineEndCh   set to the CR or LF that ended the line.
+ * @return            false if the input ended before an end of line.
+ */
+bool ASStreamingIterator::readLine(string& line, char& lineEndCh)
+{
+	// discard the input that has been read, but not while lines are peeked
+	if (windowPos >= 65536 && getPeekStart() == 0)
+	{
+		window.erase(0, windowPos);
+		windowStart += static_cast<streamoff>(windowPos);
+		windowPos = 0;
+	}
+
+	size_t lineEnd = findLineEnd(windowPos);
+	if (lineEnd == string::npos)
+	{
+		line.assign(window, windowPos, string::npos);
+		windowPos = window.length();
+		isEof = true;
+		return false;
+	}
+	line.assign(window, windowPos, lineEnd - windowPos);
+	lineEndCh = window[lineEnd];
+	windowPos = lineEnd + 1;
+	return true;
+}
+
+// return to a position saved by peekNextLine()
+void ASStreamingIterator::seekPeekStart(streamoff pos)
+{
+	isEof = false;
+	windowPos = static_cast<size_t>(pos - windowStart);
+}
+
+// set the end of input after the last end of line has been peeked
+void ASStreamingIterator::setEndOfInput()
+{
+	isEof = true;
+}
+
+// skip the second character of a CR+LF or LF+CR end of line
+void ASStreamingIterator::skipChar()
+{
+	windowPos++;
+}
+
+// return position of the next character, or -1 at the end of input
+// the same as istream tellg() which fails if eof() is set
+streamoff ASStreamingIterator::tellg()
+{
+	if (isEof)
+		return -1;
+	return windowStart + static_cast<streamoff>(windowPos);
+}
+
+#endif	// ASTYLE_LIB
+
+//-----------------------------------------------------------------------------
+// ASMappedFile class
+// used only by the console build to read the input files
+//-----------------------------------------------------------------------------
+
+#ifndef ASTYLE_LIB
+
+ASMappedFile::ASMappedFile()
+{
+	mapData = nullptr;
+	mapSize = 0;
+}
+
+ASMappedFile::~ASMappedFile()
+{
+	close();
+}
+
+// release the mapping
+void ASMappedFile::close()
+{
+	if (mapData == nullptr)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(mapData);
+#else
+	munmap(const_cast<char*>(mapData), mapSize);
+#endif
+	mapData = nullptr;
+	mapSize = 0;
+}
+
+/**
+ * Map a file into memory as read only.
+ * Empty files and files that cannot be mapped return false
+ * and must be read by the caller some other way.
+ * No error messages are displayed.
+ *
+ * @param fileName_     The path and name of the file.
+ * @return              true if the file was mapped.
+ */
+bool ASMappedFile::open(const string& fileName_)
+{
+	close();
+#ifdef _WIN32
+	HANDLE hFile = CreateFile(fileName_.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+	                          OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(hFile, &fileSize)
+	        || fileSize.QuadPart == 0
+	        || static_cast<unsigned long long>(fileSize.QuadPart) > SIZE_MAX)
+	{
+		CloseHandle(hFile);
+		return false;
+	}
+	HANDLE hMap = CreateFileMapping(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(hFile);
+	if (hMap == nullptr)
+		return false;
+	// the view keeps the mapping open after the handle is closed
+	void* view = MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(hMap);
+	if (view == nullptr)
+		return false;
+	mapData = static_cast<const char*>(view);
+	mapSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+	int fd = ::open(fileName_.c_str(), O_RDONLY);
+	if (fd == -1)
+		return false;
+	struct stat statbuf;
+	if (fstat(fd, &statbuf) != 0
+	        || !S_ISREG(statbuf.st_mode)
+	        || statbuf.st_size == 0
+	        || static_cast<unsigned long long>(statbuf.st_size) > SIZE_MAX)
+	{
+		::close(fd);
+		return false;
+	}
+	size_t fileSize = static_cast<size_t>(statbuf.st_size);
+	// the mapping remains valid after the descriptor is closed
+	void* view = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (view == MAP_FAILED)
+		return false;
+	madvise(view, fileSize, MADV_SEQUENTIAL);
+	mapData = static_cast<const char*>(view);
+	mapSize = fileSize;
+#endif
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// ASFileCache class
+// used only by the console build for the --cache option
+//-----------------------------------------------------------------------------
+
+ASFileCache::ASFileCache()
+{
+	optionsHash = 0;
+	isModified = false;
+}
+
+/**
+ * Compute a 64 bit FNV-1a hash of a block of text.
+ * A previous hash may be passed to continue hashing.
+ *
+ * @param data          The text to be hashed.
+ * @param length        The length of the text.
+ * @param hash          The starting hash value.
+ * @return              The new hash value.
+ */
+uint64_t ASFileCache::hashText(const char* data, size_t length, uint64_t hash)
+{
+	const uint64_t prime = 0x100000001b3ULL;
+	for (size_t i = 0; i < length; i++)
+	{
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= prime;
+	}
+	return hash;
+}
+
+// check if a file has not changed since it was last found unchanged
+// the number of lines in the file is returned in "lines"
+bool ASFileCache::isUnchanged(const string& path, uint64_t textHash, int& lines) const
+{
+	lock_guard<mutex> lock(cacheMutex);
+	auto entry = entries.find(path);
+	if (entry == entries.end() || entry->second.textHash != textHash)
+		return false;
+	lines = entry->second.lines;
+	return true;
+}
+
+/**
+ * Load the entries from a cache file.
+ * The entries are discarded if the file was written with different options
+ * or by a different version. A missing or invalid file is not an error.
+ *
+ * @param fileName_     The path and name of the cache file.
+ * @param optionsHash_  The hash of the current options and version.
+ */
+void ASFileCache::load(const string& fileName_, uint64_t optionsHash_)
+{
+	lock_guard<mutex> lock(cacheMutex);
+	cacheFileName = fileName_;
+	optionsHash = optionsHash_;
+	entries.clear();
+	isModified = true;
+	ifstream fin(cacheFileName.c_str(), ios::binary);
+	string line;
+	if (!fin || !getline(fin, line))
+		return;
+	char header[64];
+	snprintf(header, sizeof(header), "astyle-cache %016llx",
+	         static_cast<unsigned long long>(optionsHash));
+	if (line != header)
+		return;
+	// each entry is "hash lines path"
+	while (getline(fin, line))
+	{
+		char* hashEnd = nullptr;
+		char* linesEnd = nullptr;
+		uint64_t textHash = strtoull(line.c_str(), &hashEnd, 16);
+		if (hashEnd != line.c_str() + 16 || *hashEnd != ' ')
+			continue;
+		long lines = strtol(hashEnd + 1, &linesEnd, 10);
+		if (linesEnd == hashEnd + 1 || *linesEnd != ' ' || lines < 0)
+			continue;
+		CacheEntry& entry = entries[string(linesEnd + 1)];
+		entry.textHash = textHash;
+		entry.lines = static_cast<int>(lines);
+	}
+	isModified = false;
+}
+
+/**
+ * Write the cache file if it has been modified.
+ * The entries are sorted by path and name. A temporary file is renamed
+ * over the cache file in a single step, so an interrupted run will not
+ * leave a partial cache and there is always a cache file. The process id
+ * keeps the temporary file of each process separate when more than one
+ * process uses the same cache.
+ *
+ * @return              false if the cache file could not be written.
+ */
+bool ASFileCache::save() const
+{
+	lock_guard<mutex> lock(cacheMutex);
+	if (!isModified)
+		return true;
+	vector<string> paths;
+	paths.reserve(entries.size());
+	for (const auto& entry : entries)
+		paths.emplace_back(entry.first);
+	sort(paths.begin(), paths.end());
+
+#ifdef _WIN32
+	string tempFileName = cacheFileName + "-" + to_string(GetCurrentProcessId()) + ".tmp";
+#else
+	string tempFileName = cacheFileName + "-" + to_string(getpid()) + ".tmp";
+#endif
+	ofstream fout(tempFileName.c_str(), ios::binary | ios::trunc);
+	if (!fout)
+		return false;
+	char buffer[64];
+	snprintf(buffer, sizeof(buffer), "astyle-cache %016llx\n",
+	         static_cast<unsigned long long>(optionsHash));
+	fout << buffer;
+	for (const string& path : paths)
+	{
+		const CacheEntry& entry = entries.at(path);
+		snprintf(buffer, sizeof(buffer), "%016llx %d ",
+		         static_cast<unsigned long long>(entry.textHash), entry.lines);
+		fout << buffer << path << '\n';
+	}
+	fout.close();
+	if (fout.fail())
+	{
+		remove(tempFileName.c_str());
+		return false;
+	}
+#ifdef _WIN32
+	bool isReplaced = MoveFileEx(tempFileName.c_str(), cacheFileName.c_str(),
+	                             MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	bool isReplaced = rename(tempFileName.c_str(), cacheFileName.c_str()) == 0;
+#endif
+	if (!isReplaced)
+		remove(tempFileName.c_str());
+	return isReplaced;
+}
+
+// remove a file that was changed by formatting
+void ASFileCache::setChanged(const string& path)
+{
+	lock_guard<mutex> lock(cacheMutex);
+	if (entries.erase(path) > 0)
+		isModified = true;
+}
+
+// save a file that was not changed by formatting
+void ASFileCache::setUnchanged(const string& path, uint64_t textHash, int lines)
+{
+	// a line end in the name would corrupt the cache file
+	if (path.find_first_of("\r\n") != string::npos)
+		return;
+	lock_guard<mutex> lock(cacheMutex);
+	auto entry = entries.find(path);
+	if (entry != entries.end()
+	        && entry->second.textHash == textHash
+	        && entry->second.lines == lines)
+		return;
+	CacheEntry& newEntry = entries[path];
+	newEntry.textHash = textHash;
+	newEntry.lines = lines;
+	isModified = true;
+}
+
+//-----------------------------------------------------------------------------
+// ASFileQueue class
+// used only by the console build for the --jobs option
+//-----------------------------------------------------------------------------
+
+ASFileQueue::ASFileQueue(size_t maxQueued)
+{
+	maxSize = maxQueued;
+	isClosed = false;
+	isStopped = false;
+}
+
+// add a worker thread that formats the files from the queue
+void ASFileQueue::addWorker(thread&& worker)
+{
+	workers.emplace_back(move(worker));
+}
+
+// wait for the worker threads to finish
+// the queue must be closed or stopped
+void ASFileQueue::joinWorkers()
+{
+	for (thread& worker : workers)
+		worker.join();
+	workers.clear();
+}
+
+// no more files will be pushed, the worker threads will finish
+void ASFileQueue::close()
+{
+	lock_guard<mutex> lock(queueMutex);
+	isClosed = true;
+	queueNotEmpty.notify_all();
+}
+
+// get the next file to format, waiting if the queue is empty
+// return false if the queue is closed or stopped and there are no more files
+bool ASFileQueue::pop(size_t& index, string& path)
+{
+	unique_lock<mutex> lock(queueMutex);
+	queueNotEmpty.wait(lock, [this]() { return !files.empty() || isClosed; });
+	if (files.empty())
+		return false;
+	index = files.front().first;
+	path.swap(files.front().second);
+	files.pop_front();
+	queueNotFull.notify_one();
+	return true;
+}
+
+// add a file to be formatted, waiting if the queue is full
+// a file added after an error is skipped
+void ASFileQueue::push(size_t index, const string& path)
+{
+	unique_lock<mutex> lock(queueMutex);
+	queueNotFull.wait(lock, [this]() { return files.size() < maxSize; });
+	if (fileResult.size() <= index)
+		fileResult.resize(index + 1, FILE_PENDING);
+	if (isStopped)
+	{
+		fileResult[index] = FILE_SKIPPED;
+		resultReady.notify_all();
+		return;
+	}
+	files.emplace_back(index, path);
+	queueNotEmpty.notify_one();
+}
+
+// save the error of a file that could not be formatted
+// the files waiting in the queue are skipped and the workers finish
+void ASFileQueue::setError(size_t index, const string& message, const string& warningMessage)
+{
+	lock_guard<mutex> lock(queueMutex);
+	assert(index < fileResult.size());
+	fileResult[index] = FILE_ERROR;
+	fileError[index] = message;
+	if (!warningMessage.empty())
+		fileWarning[index] = warningMessage;
+	skipQueuedFiles();
+}
+
+// stop formatting, the files waiting in the queue are skipped
+void ASFileQueue::stop()
+{
+	lock_guard<mutex> lock(queueMutex);
+	skipQueuedFiles();
+}
+
+// skip the files waiting in the queue and any files pushed later
+// the queueMutex must be locked
+void ASFileQueue::skipQueuedFiles()
+{
+	isStopped = true;
+	isClosed = true;
+	for (const pair<size_t, string>& file : files)
+		fileResult[file.first] = FILE_SKIPPED;
+	files.clear();
+	queueNotEmpty.notify_all();
+	queueNotFull.notify_all();
+	resultReady.notify_all();
+}
+
+// save the result of formatting a file and the warnings it had
+void ASFileQueue::setResult(size_t index, bool isFormatted, const string& warningMessage)
+{
+	lock_guard<mutex> lock(queueMutex);
+	assert(index < fileResult.size());
+	fileResult[index] = isFormatted ? FILE_FORMATTED : FILE_UNCHANGED;
+	if (!warningMessage.empty())
+		fileWarning[index] = warningMessage;
+	resultReady.notify_all();
+}
+
+// wait for a file to be formatted and set isFormatted to true if it was changed
+// return false if the file had an error or was skipped
+// the errorMessage is set only for a file with an error
+// the warningMessage is set for a formatted file or a file with an error
+bool ASFileQueue::waitForResult(size_t index, bool& isFormatted, string& errorMessage,
+                                string& warningMessage)
+{
+	unique_lock<mutex> lock(queueMutex);
+	assert(index < fileResult.size());
+	resultReady.wait(lock, [&]() { return fileResult[index] != FILE_PENDING; });
+	isFormatted = (fileResult[index] == FILE_FORMATTED);
+	if (fileResult[index] == FILE_ERROR)
+		errorMessage = fileError[index];
+	unordered_map<size_t, string>::iterator warning = fileWarning.find(index);
+	if (warning != fileWarning.end())
+	{
+		warningMessage.swap(warning->second);
+		fileWarning.erase(warning);
+	}
+	return fileResult[index] == FILE_FORMATTED || fileResult[index] == FILE_UNCHANGED;
+}
+
+//-----------------------------------------------------------------------------
+// ASExcludeMatcher class
+// used only by the console build for the --exclude option
+//-----------------------------------------------------------------------------
+
+ASExcludeMatcher::ASExcludeMatcher()
+{
+	TrieNode root = { '\0', string::npos, string::npos, string::npos };
+	nodes.push_back(root);
+}
+
+// add an exclude to the trie, the characters are added from the end
+// an exclude that is already in the trie keeps the first index
+void ASExcludeMatcher::addExclude(const string& exclude, size_t excludeIndex)
+{
+	size_t node = 0;
+	for (size_t i = exclude.length(); i > 0; i--)
+	{
+		char ch = exclude[i - 1];
+		if (!g_isCaseSensitive)
+			ch = (char) tolower(ch);
+		size_t child = findChild(node, ch);
+		if (child == string::npos)
+		{
+			TrieNode newNode = { ch, string::npos, nodes[node].firstChild, string::npos };
+			child = nodes.size();
+			nodes.push_back(newNode);
+			nodes[node].firstChild = child;
+		}
+		node = child;
+	}
+	if (nodes[node].excludeIndex == string::npos)
+		nodes[node].excludeIndex = excludeIndex;
+}
+
+// find the excludes that match the end of the path
+// a match must start at the beginning of a directory or file name
+// return the lowest matching exclude index, or npos if there is no match
+size_t ASExcludeMatcher::findExclude(const string& path) const
+{
+	size_t excludeIndex = string::npos;
+	// an empty exclude matches a path ending with a separator
+	if (path.empty() || path[path.length() - 1] == g_fileSeparator)
+		excludeIndex = nodes[0].excludeIndex;
+	size_t node = 0;
+	for (size_t i = path.length(); i > 0; i--)
+	{
+		char ch = path[i - 1];
+		if (!g_isCaseSensitive)
+			ch = (char) tolower(ch);
+		node = findChild(node, ch);
+		if (node == string::npos)
+			break;
+		if (nodes[node].excludeIndex < excludeIndex
+		        && (i == 1 || path[i - 2] == g_fileSeparator))
+			excludeIndex = nodes[node].excludeIndex;
+	}
+	return excludeIndex;
+}
+
+size_t ASExcludeMatcher::findChild(size_t parent, char ch) const
+{
+	size_t child = nodes[parent].firstChild;
+	while (child != string::npos && nodes[child].ch != ch)
+		child = nodes[child].nextSibling;
+	return child;
 }
 
 //-----------------------------------------------------------------------------
@@ -328,8 +1151,6 @@ bool ASStreamIterator<T>::getLineEndChange(int lineEndFormat) const
 // main function will be included only in the console build
 //-----------------------------------------------------------------------------
 
-#ifndef ASTYLE_LIB
-
 ASConsole::ASConsole(ASFormatter& formatterArg) : formatter(formatterArg)
 {
 	errorStream = &cerr;
@@ -337,6 +1158,7 @@ ASConsole::ASConsole(ASFormatter& formatterArg) : formatter(formatterArg)
 	isRecursive = false;
 	isDryRun = false;
 	noBackup = false;
+	noFsync = false;
 	preserveDate = false;
 	isVerbose = false;
 	isQuiet = false;
@@ -344,9 +1166,12 @@ ASConsole::ASConsole(ASFormatter& formatterArg) : formatter(formatterArg)
 	ignoreExcludeErrors = false;
 	ignoreExcludeErrorsDisplay = false;
 	useAscii = false;
+	useCache = false;
+	numJobs = 1;
 	// other variables
 	bypassBrowserOpen = false;
 	hasWildcard = false;
+	isJobsWorker = false;
 	filesAreIdentical = true;
 	lineEndsMixed = false;
 	origSuffix = ".orig";
@@ -354,93 +1179,8 @@ ASConsole::ASConsole(ASFormatter& formatterArg) : formatter(formatterArg)
 	filesFormatted = 0;
 	filesUnchanged = 0;
 	linesOut = 0;
-}
-
-// rewrite a stringstream converting the line ends
-void ASConsole::convertLineEnds(ostringstream& out, int lineEnd)
-{
-	assert(lineEnd == LINEEND_WINDOWS || lineEnd == LINEEND_LINUX || lineEnd == LINEEND_MACOLD);
-	const string& inStr = out.str();	// avoids strange looking syntax
-	string outStr;						// the converted output
-	int inLength = (int) inStr.length();
-	for (int pos = 0; pos < inLength; pos++)
-	{
-		if (inStr[pos] == '\r')
-		{
-			if (inStr[pos + 1] == '\n')
-			{
-				// CRLF
-				if (lineEnd == LINEEND_CR)
-				{
-					outStr += inStr[pos];		// Delete the LF
-					pos++;
-					continue;
-				}
-				if (lineEnd == LINEEND_LF)
-				{
-					outStr += inStr[pos + 1];	// Delete the CR
-					pos++;
-					continue;
-				}
-				outStr += inStr[pos];			// Do not change
-				outStr += inStr[pos + 1];
-				pos++;
-				continue;
-			}
-			else                                // NOLINT
-			{
-				// CR
-				if (lineEnd == LINEEND_CRLF)
-				{
-					outStr += inStr[pos];		// Insert the CR
-					outStr += '\n';				// Insert the LF
-					continue;
-				}
-				if (lineEnd == LINEEND_LF)
-				{
-					outStr += '\n';				// Insert the LF
-					continue;
-				}
-				outStr += inStr[pos];		// Do not change
-				continue;
-			}
-		}
-		else if (inStr[pos] == '\n')
-		{
-			// LF
-			if (lineEnd == LINEEND_CRLF)
-			{
-				outStr += '\r';				// Insert the CR
-				outStr += inStr[pos];		// Insert the LF
-				continue;
-			}
-			if (lineEnd == LINEEND_CR)
-			{
-				outStr += '\r';				// Insert the CR
-				continue;
-			}
-			outStr += inStr[pos];		// Do not change
-			continue;
-		}
-		else
-		{
-			outStr += inStr[pos];		// Write the current char
-		}
-	}
-	// replace the stream
-	out.str(outStr);
-}
-
-void ASConsole::correctMixedLineEnds(ostringstream& out)
-{
-	LineEndFormat lineEndFormat = LINEEND_DEFAULT;
-	if (outputEOL == "\r\n")
-		lineEndFormat = LINEEND_WINDOWS;
-	if (outputEOL == "\n")
-		lineEndFormat = LINEEND_LINUX;
-	if (outputEOL == "\r")
-		lineEndFormat = LINEEND_MACOLD;
-	convertLineEnds(out, lineEndFormat);
+	fileQueue = nullptr;
+	fileCache = nullptr;
 }
 
 // check files for 16 or 32 bit encoding
@@ -467,17 +1207,36 @@ FileEncoding ASConsole::detectEncoding(const char* data, size_t dataSize) const
 // error exit without a message
 void ASConsole::error() const
 {
+	stopFileQueue();
 	(*errorStream) << _("Artistic Style has terminated\n") << endl;
 	exit(EXIT_FAILURE);
 }
 
 // error exit with a message
+// a --jobs worker saves the message and returns, the main thread displays it
 void ASConsole::error(const char* why, const char* what) const
 {
+	if (isJobsWorker)
+	{
+		if (workerError.empty())
+			workerError = string(why) + ' ' + what;
+		return;
+	}
+	stopFileQueue();
 	(*errorStream) << why << ' ' << what << endl;
 	error();
 }
 
+// stop the --jobs workers if an error is found while the files are queued
+// the files being formatted are finished before the program exits
+void ASConsole::stopFileQueue() const
+{
+	if (fileQueue == nullptr)
+		return;
+	fileQueue->stop();
+	fileQueue->joinWorkers();
+}
+
 /**
  * If no files have been given, use cin for input and cout for output.
  *
@@ -499,21 +1258,9 @@ void ASConsole::formatCinToCout()
 
 	}
 	// Using cin.tellg() causes problems with both Windows and Linux.
-	// The Windows problem occurs when the input is not Windows line-ends.
-	// The tellg() will be out of sequence with the get() statements.
-	// The Linux cin.tellg() will return -1 (invalid).
-	// Copying the input sequentially to a stringstream before
-	// formatting solves the problem for both.
-	istream* inStream = &cin;
-	stringstream outStream;
-	char ch;
-	inStream->get(ch);
-	while (!inStream->eof() && !inStream->fail())
-	{
-		outStream.put(ch);
-		inStream->get(ch);
-	}
-	ASStreamIterator<stringstream> streamIterator(&outStream);
+	// The streaming iterator reads stdin in blocks and keeps its own
+	// position, so lines are formatted and output as the input arrives.
+	ASStreamingIterator streamIterator(fileno(stdin));
 	// Windows pipe or redirection always outputs Windows line-ends.
 	// Linux pipe or redirection will output any line end.
 #ifdef _WIN32
@@ -544,6 +1291,8 @@ void ASConsole::formatCinToCout()
 		}
 	}
 	cout.flush();
+	if (streamIterator.hasReadError())
+		error("Cannot read input file", stdPathIn.empty() ? "stdin" : stdPathIn.c_str());
 }
 
 /**
@@ -553,9 +1302,169 @@ void ASConsole::formatCinToCout()
  */
 void ASConsole::formatFile(const string& fileName_)
 {
-	stringstream in;
-	ostringstream out;
-	FileEncoding encoding = readFile(fileName_, in);
+	bool isFormatted = formatFileText(fileName_);
+	printFileResult(fileName_, isFormatted);
+}
+
+/**
+ * Get the files for a file path and format them using a pool of worker threads.
+ * Each worker has its own ASFormatter and ASConsole configured from the
+ * parsed option vectors. The files are queued as each directory is read so
+ * the formatting overlaps the directory scan. The results are printed in
+ * fileName order after the scan so the display and the counts are the same
+ * as for a serial run. An error in a worker stops the formatting. It is
+ * displayed in fileName order and the program exits after the workers end.
+ *
+ * @param filePath      The path and name of the files to be processed.
+ */
+void ASConsole::formatFilesParallel(const string& filePath)
+{
+	vector<unique_ptr<ASFormatter>> workerFormatters;
+	vector<unique_ptr<ASConsole>> workerConsoles;
+	for (int i = 0; i < numJobs; i++)
+	{
+		workerFormatters.emplace_back(new ASFormatter);
+		workerConsoles.emplace_back(new ASConsole(*workerFormatters.back()));
+		ASConsole& worker = *workerConsoles.back();
+		// the options have already been checked for errors
+		ASOptions options(*workerFormatters.back(), worker);
+		vector<string> workerOptions = fileOptionsVector;
+		options.parseOptions(workerOptions, string());
+		workerOptions = projectOptionsVector;
+		options.parseOptions(workerOptions, string());
+		workerOptions = optionsVector;
+		options.parseOptions(workerOptions, string());
+		worker.errorStream = errorStream;
+		worker.isJobsWorker = true;
+		worker.isDryRun = isDryRun;
+		worker.noBackup = noBackup;
+		worker.noFsync = noFsync;
+		worker.preserveDate = preserveDate;
+		worker.origSuffix = origSuffix;
+		worker.fileCache = fileCache;
+	}
+
+	// An unmatched exclude is an error that must be found before any
+	// files are formatted, so the scan cannot overlap the formatting.
+	bool isScanOverlapped = excludeVector.empty() || ignoreExcludeErrors;
+	if (!isScanOverlapped)
+		getFilePaths(filePath);
+
+	ASFileQueue queue(numJobs * 16);
+	for (int i = 0; i < numJobs; i++)
+	{
+		ASConsole* worker = workerConsoles[i].get();
+		queue.addWorker(thread([&queue, worker]()
+		{
+			size_t index;
+			string path;
+			while (queue.pop(index, path))
+			{
+				bool isFormatted = worker->formatFileText(path);
+				string warningMessage;
+				warningMessage.swap(worker->workerWarning);
+				if (!worker->workerError.empty())
+				{
+					queue.setError(index, worker->workerError, warningMessage);
+					break;
+				}
+				queue.setResult(index, isFormatted, warningMessage);
+			}
+		}));
+	}
+
+	// a scan error calls error(), which stops the queue and joins the workers
+	if (isScanOverlapped)
+	{
+		fileQueue = &queue;
+		getFilePaths(filePath);
+		fileQueue = nullptr;
+	}
+	else
+	{
+		for (size_t i = 0; i < fileName.size(); i++)
+			queue.push(i, fileName[i]);
+	}
+	queue.close();
+
+	// print the results in order as they become available
+	bool hasError = false;
+	for (size_t i = 0; i < fileName.size(); i++)
+	{
+		bool isFormatted;
+		string errorMessage;
+		string warningMessage;
+		bool isResult = queue.waitForResult(i, isFormatted, errorMessage, warningMessage);
+		(*errorStream) << warningMessage;
+		if (isResult)
+			printFileResult(fileName[i], isFormatted);
+		else if (!errorMessage.empty())
+		{
+			(*errorStream) << errorMessage << endl;
+			hasError = true;
+		}
+	}
+
+	queue.joinWorkers();
+	for (int i = 0; i < numJobs; i++)
+		linesOut += workerConsoles[i]->linesOut;
+	if (hasError)
+		error();
+}
+
+/**
+ * Format a file and write it if it has changed.
+ * Nothing is displayed. The result is printed by printFileResult().
+ *
+ * A --jobs worker returns after an error, the error is in workerError.
+ *
+ * @param fileName_     The path and name of the file to be processed.
+ * @return              true if the file was formatted, false if unchanged.
+ */
+bool ASConsole::formatFileText(const string& fileName_)
+{
+	string out;		// the output lines ended by '\n', see writeOutputText()
+	// 8 bit and utf-8 files are formatted directly from a memory mapping
+	// utf-16 files and files that cannot be mapped are read into a string
+	ASMappedFile mappedFile;
+	string text;
+	FileEncoding encoding = ENCODING_8BIT;
+	if (mappedFile.open(fileName_))
+	{
+		encoding = detectEncoding(mappedFile.getData(), mappedFile.getSize());
+		if (encoding == UTF_32BE || encoding == UTF_32LE)
+		{
+			error(_("Cannot process UTF-32 encoding"), fileName_.c_str());
+			return false;
+		}
+		if (encoding == UTF_16BE || encoding == UTF_16LE)
+			mappedFile.close();
+	}
+	if (mappedFile.getData() == nullptr)
+	{
+		stringstream in;
+		encoding = readFile(fileName_, in);
+		if (!workerError.empty())
+			return false;
+		text = in.str();
+	}
+	const char* textData = mappedFile.getData() ? mappedFile.getData() : text.data();
+	size_t textLength = mappedFile.getData() ? mappedFile.getSize() : text.length();
+
+	// skip a file that has not changed since it was last found unchanged
+	uint64_t textHash = 0;
+	if (fileCache != nullptr)
+	{
+		int cachedLines = 0;
+		textHash = ASFileCache::hashText(textData, textLength);
+		if (fileCache->isUnchanged(fileName_, textHash, cachedLines))
+		{
+			filesAreIdentical = true;
+			linesOut += cachedLines;
+			return false;
+		}
+	}
+	int linesOutStart = linesOut;
 
 	// Unless a specific language mode has been set, set the language mode
 	// according to the file's suffix.
@@ -575,19 +1484,20 @@ void ASConsole::formatFile(const string& fileName_)
 	LineEndFormat lineEndFormat = formatter.getLineEndFormat();
 	initializeOutputEOL(lineEndFormat);
 	// do this AFTER setting the file mode
-	ASStreamIterator<stringstream> streamIterator(&in);
+	ASBufferIterator streamIterator(textData, textLength);
 	formatter.init(&streamIterator);
+	out.reserve(textLength + textLength / 8);
 
 	// format the file
 	while (formatter.hasMoreLines())
 	{
 		nextLine = formatter.nextLine();
-		out << nextLine;
+		out.append(nextLine);
 		linesOut++;
 		if (formatter.hasMoreLines())
 		{
 			setOutputEOL(lineEndFormat, streamIterator.getOutputEOL());
-			out << outputEOL;
+			out.append(1, '\n');
 		}
 		else
 		{
@@ -596,9 +1506,9 @@ void ASConsole::formatFile(const string& fileName_)
 			if (formatter.getIsLineReady())
 			{
 				setOutputEOL(lineEndFormat, streamIterator.getOutputEOL());
-				out << outputEOL;
+				out.append(1, '\n');
 				nextLine = formatter.nextLine();
-				out << nextLine;
+				out.append(nextLine);
 				linesOut++;
 				streamIterator.saveLastInputLine();
 			}
@@ -616,36 +1526,54 @@ void ASConsole::formatFile(const string& fileName_)
 			streamIterator.checkForEmptyLine = false;
 		}
 	}
-	// correct for mixed line ends
+	// mixed line ends are corrected by writeOutputText()
+	// the outputEOL is now the line end used for the entire file
 	if (lineEndsMixed)
-	{
-		correctMixedLineEnds(out);
 		filesAreIdentical = false;
-	}
 
-	// remove targetDirectory from filename if required by print
-	string displayName;
-	if (hasWildcard)
-		displayName = fileName_.substr(targetDirectory.length() + 1);
-	else
-		displayName = fileName_;
+	assert(formatter.getChecksumDiff() == 0);
 
 	// if file has changed, write the new file
 	if (!filesAreIdentical || streamIterator.getLineEndChange(lineEndFormat))
 	{
+		// Windows cannot rename or remove a mapped file
+		mappedFile.close();
+		if (fileCache != nullptr)
+			fileCache->setChanged(fileName_);
 		if (!isDryRun)
 			writeFile(fileName_, encoding, out);
-		printMsg(_("Formatted  %s\n"), displayName);
-		filesFormatted++;
-	}
-	else
-	{
-		if (!isFormattedOnly)
-			printMsg(_("Unchanged  %s\n"), displayName);
-		filesUnchanged++;
+		return true;
 	}
+	if (fileCache != nullptr)
+		fileCache->setUnchanged(fileName_, textHash, linesOut - linesOutStart);
+	return false;
+}
 
-	assert(formatter.getChecksumDiff() == 0);
+/**
+ * Get the path and name of the cache file for the --cache option.
+ * It is in the directory of the project option file if there is one,
+ * otherwise it is in the current directory.
+ *
+ * @return              The full path and name of the cache file.
+ */
+string ASConsole::getCacheFileName() const
+{
+	const string cacheName = ".astyle-cache";
+	size_t separator = projectOptionFileName.find_last_of(g_fileSeparator);
+	if (separator != string::npos)
+		return projectOptionFileName.substr(0, separator + 1) + cacheName;
+	return getCurrentDirectory(cacheName) + g_fileSeparator + cacheName;
+}
+
+// hash the formatting options and version for the --cache option
+// a change in the formatting options will cause all files to be formatted
+// the console options, such as --jobs or --quiet, are not included
+uint64_t ASConsole::getOptionsHash() const
+{
+	uint64_t hash = ASFileCache::hashText(g_version, strlen(g_version) + 1);
+	for (const string& option : formatterOptionsVector)
+		hash = ASFileCache::hashText(option.c_str(), option.length() + 1, hash);
+	return hash;
 }
 
 /**
@@ -755,10 +1683,22 @@ bool ASConsole::getIsVerbose() const
 bool ASConsole::getLineEndsMixed() const
 { return lineEndsMixed; }
 
+// for unit testing
+int ASConsole::getLinesOut() const
+{ return linesOut; }
+
 // for unit testing
 bool ASConsole::getNoBackup() const
 { return noBackup; }
 
+// for unit testing
+bool ASConsole::getNoFsync() const
+{ return noFsync; }
+
+// for unit testing
+int ASConsole::getNumJobs() const
+{ return numJobs; }
+
 // for unit testing
 string ASConsole::getOptionFileName() const
 { return optionFileName; }
@@ -775,6 +1715,10 @@ string ASConsole::getOrigSuffix() const
 bool ASConsole::getPreserveDate() const
 { return preserveDate; }
 
+// for unit testing
+bool ASConsole::getUseCache() const
+{ return useCache; }
+
 // for unit testing
 string ASConsole::getProjectOptionFileName() const
 {
@@ -886,23 +1830,37 @@ void ASConsole::initializeOutputEOL(LineEndFormat lineEndFormat)
 }
 
 // read a file into the stringstream 'in'
+// a --jobs worker returns after an error, the error is in workerError
 FileEncoding ASConsole::readFile(const string& fileName_, stringstream& in) const
 {
 	const int blockSize = 65536;	// 64 KB
 	ifstream fin(fileName_.c_str(), ios::binary);
 	if (!fin)
+	{
 		error("Cannot open file", fileName_.c_str());
+		return ENCODING_8BIT;
+	}
 	char* data = new (nothrow) char[blockSize];
 	if (data == nullptr)
+	{
 		error("Cannot allocate memory to open file", fileName_.c_str());
+		return ENCODING_8BIT;
+	}
 	fin.read(data, blockSize);
 	if (fin.bad())
+	{
+		delete[] data;
 		error("Cannot read file", fileName_.c_str());
+		return ENCODING_8BIT;
+	}
 	size_t dataSize = static_cast<size_t>(fin.gcount());
 	FileEncoding encoding = detectEncoding(data, dataSize);
 	if (encoding == UTF_32BE || encoding == UTF_32LE)
+	{
+		delete[] data;
 		error(_("Cannot process UTF-32 encoding"), fileName_.c_str());
-	bool firstBlock = true;
+		return encoding;
+	}
 	bool isBigEndian = (encoding == UTF_16BE);
 	while (dataSize != 0)
 	{
@@ -912,8 +1870,12 @@ FileEncoding ASConsole::readFile(const string& fileName_, stringstream& in) cons
 			size_t utf8Size = encode.utf8LengthFromUtf16(data, dataSize, isBigEndian);
 			char* utf8Out = new (nothrow) char[utf8Size];
 			if (utf8Out == nullptr)
+			{
+				delete[] data;
 				error("Cannot allocate memory for utf-8 conversion", fileName_.c_str());
-			size_t utf8Len = encode.utf16ToUtf8(data, dataSize, isBigEndian, firstBlock, utf8Out);
+				return encoding;
+			}
+			size_t utf8Len = encode.utf16ToUtf8(data, dataSize, isBigEndian, utf8Out);
 			assert(utf8Len <= utf8Size);
 			in << string(utf8Out, utf8Len);
 			delete[] utf8Out;
@@ -922,9 +1884,12 @@ FileEncoding ASConsole::readFile(const string& fileName_, stringstream& in) cons
 			in << string(data, dataSize);
 		fin.read(data, blockSize);
 		if (fin.bad())
+		{
+			delete[] data;
 			error("Cannot read file", fileName_.c_str());
+			return encoding;
+		}
 		dataSize = static_cast<size_t>(fin.gcount());
-		firstBlock = false;
 	}
 	fin.close();
 	delete[] data;
@@ -955,6 +1920,12 @@ void ASConsole::setIsVerbose(bool state)
 void ASConsole::setNoBackup(bool state)
 { noBackup = state; }
 
+void ASConsole::setNoFsync(bool state)
+{ noFsync = state; }
+
+void ASConsole::setNumJobs(int jobs)
+{ numJobs = jobs; }
+
 void ASConsole::setOptionFileName(const string& name)
 { optionFileName = name; }
 
@@ -973,6 +1944,9 @@ void ASConsole::setStdPathIn(const string& path)
 void ASConsole::setStdPathOut(const string& path)
 { stdPathOut = path; }
 
+void ASConsole::setUseCache(bool state)
+{ useCache = state; }
+
 // set outputEOL variable
 void ASConsole::setOutputEOL(LineEndFormat lineEndFormat, const string& currentEOL)
 {
@@ -1061,6 +2035,9 @@ void ASConsole::getFileNames(const string& directory, const vector<string>& wild
 		error(_("Cannot open directory"), directory.c_str());
 	}
 
+	// save the first fileName entry for this recursion
+	const size_t firstEntry = fileName.size();
+
 	// save files and sub directories
 	do
 	{
@@ -1108,6 +2085,13 @@ void ASConsole::getFileNames(const string& directory, const vector<string>& wild
 	if (dwError != ERROR_NO_MORE_FILES)
 		error("Error processing directory", directory.c_str());
 
+	// start formatting the entries for the --jobs threads
+	if (fileQueue != nullptr)
+	{
+		for (size_t i = firstEntry; i < fileName.size(); i++)
+			fileQueue->push(i, fileName[i]);
+	}
+
 	// recurse into sub directories
 	// if not doing recursive subDirectory is empty
 	for (const string& subDirectoryName : subDirectory)
@@ -1279,37 +2263,89 @@ string ASConsole::getCurrentDirectory(const string& fileName_) const
  */
 void ASConsole::getFileNames(const string& directory, const vector<string>& wildcards)
 {
-	struct dirent* entry;           // entry from readdir()
-	struct stat statbuf;            // entry from stat()
-	vector<string> subDirectory;    // sub directories of this directory
-
 	// errno is defined in <errno.h> and is set for errors in opendir, readdir, or stat
 	errno = 0;
 
-	DIR* dp = opendir(directory.c_str());
+	int dirFd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dirFd < 0)
+		error(_("Cannot open directory"), directory.c_str());
+	getFileNamesAt(dirFd, directory, wildcards);
+}
+
+/**
+ * LINUX function to read a directory for getFileNames().
+ * The entries are checked with fstatat(), relative to the directory, so the
+ * path is not resolved again for each entry. The entry type from readdir()
+ * is used to skip the entries that cannot be used without calling fstatat().
+ * The directory is closed before recursing so the open file descriptors
+ * do not increase with the depth of the tree.
+ *
+ * @param dirFd         The open directory, it is closed on return.
+ * @param directory     The path of the directory to be processed.
+ * @param wildcards     A vector of wildcards to be processed (e.g. *.cpp).
+ */
+void ASConsole::getFileNamesAt(int dirFd, const string& directory, const vector<string>& wildcards)
+{
+	struct dirent* entry;           // entry from readdir()
+	struct stat statbuf;            // entry from fstatat()
+	vector<string> subDirectory;    // sub directories of this directory
+	string entryFilepath;           // path of the current entry
+
+	DIR* dp = fdopendir(dirFd);
 	if (dp == nullptr)
+	{
+		close(dirFd);
 		error(_("Cannot open directory"), directory.c_str());
+	}
 
 	// save the first fileName entry for this recursion
-	const unsigned firstEntry = fileName.size();
+	const size_t firstEntry = fileName.size();
 
 	// save files and sub directories
 	while ((entry = readdir(dp)) != nullptr)
 	{
+		// skip hidden
+		if (entry->d_name[0] == '.')
+			continue;
+		entryFilepath.assign(directory);
+		entryFilepath.append(1, g_fileSeparator);
+		entryFilepath.append(entry->d_name);
+		bool isWildcardMatch = false;
+		for (const string& wildcard : wildcards)
+		{
+			if (wildcmp(wildcard.c_str(), entry->d_name) != 0)
+			{
+				isWildcardMatch = true;
+				break;
+			}
+		}
+#ifdef DT_UNKNOWN
+		// a symbolic link or an unknown type must be checked by fstatat()
+		unsigned char entryType = entry->d_type;
+		if (entryType == DT_DIR && !isRecursive)
+			continue;
+		// a regular file is checked only if it is used or excluded
+		if (entryType == DT_REG
+		        && !isWildcardMatch
+		        && excludeMatcher.findExclude(entryFilepath) == string::npos)
+			continue;
+		if (entryType != DT_DIR && entryType != DT_REG
+		        && entryType != DT_LNK && entryType != DT_UNKNOWN)
+			continue;
+#endif
 		// get file status
-		string entryFilepath = directory + g_fileSeparator + entry->d_name;
-		if (stat(entryFilepath.c_str(), &statbuf) != 0)
+		if (fstatat(dirfd(dp), entry->d_name, &statbuf, 0) != 0)
 		{
 			if (errno == EOVERFLOW)         // file over 2 GB is OK
 			{
 				errno = 0;
 				continue;
 			}
-			perror("errno message");
+			printErrnoMessage();
 			error("Error getting file status in directory", directory.c_str());
 		}
-		// skip hidden or read only
-		if (entry->d_name[0] == '.' || !(statbuf.st_mode & S_IWUSR))
+		// skip read only
+		if (!(statbuf.st_mode & S_IWUSR))
 			continue;
 		// if a sub directory and recursive, save sub directory
 		if (S_ISDIR(statbuf.st_mode) && isRecursive)
@@ -1327,38 +2363,39 @@ void ASConsole::getFileNames(const string& directory, const vector<string>& wild
 			// check exclude before wildcmp to avoid "unmatched exclude" error
 			bool isExcluded = isPathExclued(entryFilepath);
 			// save file name if wildcard match
-			for (const string& wildcard : wildcards)
+			if (isWildcardMatch)
 			{
-				if (wildcmp(wildcard.c_str(), entry->d_name) != 0)
-				{
-					if (isExcluded)
-						printMsg(_("Exclude  %s\n"), entryFilepath.substr(mainDirectoryLength));
-					else
-						fileName.emplace_back(entryFilepath);
-					break;
-				}
+				if (isExcluded)
+					printMsg(_("Exclude  %s\n"), entryFilepath.substr(mainDirectoryLength));
+				else
+					fileName.emplace_back(entryFilepath);
 			}
 		}
 	}
 
+	// sort the current entries for fileName
+	if (firstEntry < fileName.size())
+		sort(fileName.begin() + firstEntry, fileName.end());
+
+	// start formatting the entries for the --jobs threads
+	if (fileQueue != nullptr)
+	{
+		for (size_t i = firstEntry; i < fileName.size(); i++)
+			fileQueue->push(i, fileName[i]);
+	}
+
 	if (closedir(dp) != 0)
 	{
-		perror("errno message");
+		printErrnoMessage();
 		error("Error reading directory", directory.c_str());
 	}
 
-	// sort the current entries for fileName
-	if (firstEntry < fileName.size())
-		sort(fileName.begin() + firstEntry, fileName.end());
-
 	// recurse into sub directories
 	// if not doing recursive, subDirectory is empty
 	if (subDirectory.size() > 1)
 		sort(subDirectory.begin(), subDirectory.end());
-	for (unsigned i = 0; i < subDirectory.size(); i++)
-	{
+	for (size_t i = 0; i < subDirectory.size(); i++)
 		getFileNames(subDirectory[i], wildcards);
-	}
 }
 
 // LINUX function to get the full path name from the relative path name
@@ -1371,6 +2408,22 @@ string ASConsole::getFullPathName(const string& relativePath) const
 	return fullPath;
 }
 
+// LINUX function to flush the directory of a replaced file to the disk.
+// The rename of the file is not durable until the directory is flushed.
+void ASConsole::syncDirectory(const string& fileName_) const
+{
+	size_t separator = fileName_.find_last_of(g_fileSeparator);
+	string directory = ".";
+	if (separator != string::npos)
+		directory = fileName_.substr(0, max(separator, (size_t) 1));
+	int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd != -1)
+	{
+		fsync(fd);
+		close(fd);
+	}
+}
+
 // LINUX function to get the documentation file path prefix
 //     from the executable file path.
 // Return the documentation path prefix or an empty string if failed.
@@ -1665,7 +2718,11 @@ void ASConsole::getFilePaths(const string& filePath)
 		string entryFilepath = targetDirectory + g_fileSeparator + targetFilename;
 		struct stat statbuf;
 		if (stat(entryFilepath.c_str(), &statbuf) == 0 && (statbuf.st_mode & S_IFREG))
+		{
 			fileName.emplace_back(entryFilepath);
+			if (fileQueue != nullptr)
+				fileQueue->push(0, entryFilepath);
+		}
 	}
 
 	// check for unprocessed excludes
@@ -1744,47 +2801,15 @@ bool ASConsole::isParamOption(const string& arg, const char* option)
 
 // compare a path to the exclude vector
 // used for both directories and filenames
-// updates the g_excludeHitsVector
+// updates the excludeHitsVector for the first matching exclude
 // return true if a match
 bool ASConsole::isPathExclued(const string& subPath)
 {
-	bool retVal = false;
-
-	// read the exclude vector checking for a match
-	for (size_t i = 0; i < excludeVector.size(); i++)
-	{
-		string exclude = excludeVector[i];
-
-		if (subPath.length() < exclude.length())
-			continue;
-
-		size_t compareStart = subPath.length() - exclude.length();
-		// subPath compare must start with a directory name
-		if (compareStart > 0)
-		{
-			char lastPathChar = subPath[compareStart - 1];
-			if (lastPathChar != g_fileSeparator)
-				continue;
-		}
-
-		string compare = subPath.substr(compareStart);
-		if (!g_isCaseSensitive)
-		{
-			// make it case insensitive for Windows
-			for (size_t j = 0; j < compare.length(); j++)
-				compare[j] = (char) tolower(compare[j]);
-			for (size_t j = 0; j < exclude.length(); j++)
-				exclude[j] = (char) tolower(exclude[j]);
-		}
-		// compare sub directory to exclude data - must check them all
-		if (compare == exclude)
-		{
-			excludeHitsVector[i] = true;
-			retVal = true;
-			break;
-		}
-	}
-	return retVal;
+	size_t excludeIndex = excludeMatcher.findExclude(subPath);
+	if (excludeIndex == string::npos)
+		return false;
+	excludeHitsVector[excludeIndex] = true;
+	return true;
 }
 
 void ASConsole::printHelp() const
@@ -2219,6 +3244,21 @@ void ASConsole::printHelp() const
 	cout << "    Print errors and help information to standard-output rather than\n";
 	cout << "    to standard-error.\n";
 	cout << endl;
+	cout << "    --jobs=#\n";
+	cout << "    Format files in parallel using # threads. The valid values\n";
+	cout << "    are 0 thru 256. A value of 0 uses the number of processors.\n";
+	cout << "    The display order is the same as a single threaded run.\n";
+	cout << endl;
+	cout << "    --cache\n";
+	cout << "    Skip files that are unchanged since the last run with the same\n";
+	cout << "    options. The cache file .astyle-cache is in the directory of\n";
+	cout << "    the project option file, or in the current directory.\n";
+	cout << endl;
+	cout << "    --no-fsync\n";
+	cout << "    Do not flush the formatted files to the disk before they replace\n";
+	cout << "    the original files. This is faster but a system failure may\n";
+	cout << "    leave a file that has not been completely written.\n";
+	cout << endl;
 	cout << "    --preserve-date  OR  -Z\n";
 	cout << "    Preserve the original file's date and time modified. The time\n";
 	cout << "     modified will be changed a few micro seconds to force a compile.\n";
@@ -2295,9 +3335,23 @@ void ASConsole::processFiles()
 
 	clock_t startTime = clock();     // start time of file formatting
 
+	// the cache is shared with the --jobs worker consoles
+	ASFileCache cache;
+	if (useCache)
+	{
+		cache.load(getCacheFileName(), getOptionsHash());
+		fileCache = &cache;
+	}
+
 	// loop thru input fileNameVector and process the files
 	for (const string& fileNameVectorName : fileNameVector)
 	{
+		if (numJobs > 1)
+		{
+			formatFilesParallel(fileNameVectorName);
+			continue;
+		}
+
 		getFilePaths(fileNameVectorName);
 
 		// loop thru fileName vector formatting the files
@@ -2305,6 +3359,13 @@ void ASConsole::processFiles()
 			formatFile(file);
 	}
 
+	if (useCache)
+	{
+		fileCache = nullptr;
+		if (!cache.save())
+			error("Cannot write cache file", cache.getCacheFileName().c_str());
+	}
+
 	// files are processed, display stats
 	if (isVerbose)
 		printVerboseStats(startTime);
@@ -2546,10 +3607,73 @@ void ASConsole::processOptions(const vector<string>& argvOptions)
 		(*errorStream) << _("For help on options type 'astyle -h'") << endl;
 		error();
 	}
+	formatterOptionsVector = options.getFormatterOptions();
+}
+
+// copy a file with its permissions and check for an error
+// return false if a --jobs worker had an error
+bool ASConsole::copyFile(const char* oldFileName, const char* newFileName, const char* errMsg) const
+{
+	ifstream fin(oldFileName, ios::binary);
+	ofstream fout(newFileName, ios::binary | ios::trunc);
+	// an empty stream buffer would set the fout failbit
+	if (fin && fout && fin.peek() != EOF)
+		fout << fin.rdbuf();
+	fout.close();
+	if (!fin || !fout)
+	{
+		printErrnoMessage();
+		remove(newFileName);
+		error(errMsg, oldFileName);
+		return false;
+	}
+#ifndef _WIN32
+	struct stat stBuf;
+	if (stat(oldFileName, &stBuf) == 0)
+		chmod(newFileName, stBuf.st_mode & 07777);
+#endif
+	return true;
+}
+
+// create a new empty file that does not already exist
+// return false if the file exists or the directory cannot be written
+bool ASConsole::createTempFile(const string& fileName_) const
+{
+#ifdef _WIN32
+	HANDLE hFile = CreateFile(fileName_.c_str(), GENERIC_WRITE, 0, nullptr,
+	                          CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+	CloseHandle(hFile);
+#else
+	int fd = open(fileName_.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+	if (fd == -1)
+	{
+		errno = 0;
+		return false;
+	}
+	close(fd);
+#endif
+	return true;
+}
+
+// get a temporary file name in the directory of a file
+// the process id keeps the name unique if files are formatted by more than one process,
+// the count keeps it unique if --jobs workers write the same file through symbolic links
+string ASConsole::getTempFileName(const string& fileName_) const
+{
+	static atomic<unsigned> tempFileCount(0);
+#ifdef _WIN32
+	unsigned long processId = GetCurrentProcessId();
+#else
+	unsigned long processId = getpid();
+#endif
+	return fileName_ + ".astyle-" + to_string(processId) + "-" + to_string(++tempFileCount) + ".tmp";
 }
 
 // remove a file and check for an error
-void ASConsole::removeFile(const char* fileName_, const char* errMsg) const
+// return false if a --jobs worker had an error
+bool ASConsole::removeFile(const char* fileName_, const char* errMsg) const
 {
 	if (remove(fileName_) != 0)
 	{
@@ -2557,14 +3681,17 @@ void ASConsole::removeFile(const char* fileName_, const char* errMsg) const
 			errno = 0;
 		if (errno)
 		{
-			perror("errno message");
+			printErrnoMessage();
 			error(errMsg, fileName_);
+			return false;
 		}
 	}
+	return true;
 }
 
 // rename a file and check for an error
-void ASConsole::renameFile(const char* oldFileName, const char* newFileName, const char* errMsg) const
+// return false if a --jobs worker had an error
+bool ASConsole::renameFile(const char* oldFileName, const char* newFileName, const char* errMsg) const
 {
 	int result = rename(oldFileName, newFileName);
 	if (result != 0)
@@ -2578,10 +3705,32 @@ void ASConsole::renameFile(const char* oldFileName, const char* newFileName, con
 		}
 		if (result != 0)
 		{
-			perror("errno message");
+			printErrnoMessage();
 			error(errMsg, oldFileName);
+			return false;
 		}
 	}
+	return true;
+}
+
+// rename a file over an existing file and check for an error
+// the existing file is replaced in a single step
+// return false if a --jobs worker had an error
+bool ASConsole::replaceFile(const char* oldFileName, const char* newFileName, const char* errMsg) const
+{
+#ifdef _WIN32
+	bool isReplaced = MoveFileEx(oldFileName, newFileName, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	bool isReplaced = rename(oldFileName, newFileName) == 0;
+#endif
+	if (!isReplaced)
+	{
+		printErrnoMessage();
+		remove(oldFileName);
+		error(errMsg, newFileName);
+		return false;
+	}
+	return true;
 }
 
 // make sure file separators are correct type (Windows or Linux)
@@ -2648,6 +3797,41 @@ void ASConsole::standardizePath(string& path, bool removeBeginningSeparator /*fa
 		path.erase(0, 1);
 }
 
+// print the errno message of a failed system call
+// a --jobs worker saves the message, the main thread displays it with the file result
+void ASConsole::printErrnoMessage() const
+{
+	if (isJobsWorker)
+	{
+		workerWarning.append("errno message: ").append(strerror(errno)).append("\n");
+		return;
+	}
+	perror("errno message");
+}
+
+// print the formatted or unchanged message for a file and update the counts
+void ASConsole::printFileResult(const string& fileName_, bool isFormatted)
+{
+	// remove targetDirectory from filename if required by print
+	string displayName;
+	if (hasWildcard)
+		displayName = fileName_.substr(targetDirectory.length() + 1);
+	else
+		displayName = fileName_;
+
+	if (isFormatted)
+	{
+		printMsg(_("Formatted  %s\n"), displayName);
+		filesFormatted++;
+	}
+	else
+	{
+		if (!isFormattedOnly)
+			printMsg(_("Unchanged  %s\n"), displayName);
+		filesUnchanged++;
+	}
+}
+
 void ASConsole::printMsg(const char* msg, const string& data) const
 {
 	if (isQuiet)
@@ -2655,6 +3839,18 @@ void ASConsole::printMsg(const char* msg, const string& data) const
 	printf(msg, data.c_str());
 }
 
+// print a warning that does not stop the formatting
+// a --jobs worker saves the warning, the main thread displays it with the file result
+void ASConsole::printWarning(const char* msg) const
+{
+	if (isJobsWorker)
+	{
+		workerWarning.append(msg).append("\n");
+		return;
+	}
+	(*errorStream) << msg << endl;
+}
+
 void ASConsole::printSeparatingLine() const
 {
 	string line;
@@ -2765,6 +3961,7 @@ void ASConsole::updateExcludeVector(const string& suffixParam)
 {
 	excludeVector.emplace_back(suffixParam);
 	standardizePath(excludeVector.back(), true);
+	excludeMatcher.addExclude(excludeVector.back(), excludeVector.size() - 1);
 	// do not use emplace_back on vector<bool> until supported by macOS
 	excludeHitsVector.push_back(false);
 }
@@ -2846,7 +4043,85 @@ int ASConsole::wildcmp(const char* wild, const char* data) const
 	return !*wild;
 }
 
-void ASConsole::writeFile(const string& fileName_, FileEncoding encoding, ostringstream& out) const
+/**
+ * Write the formatted text to an output stream.
+ * The lines of the text are ended by '\n'. Each line end is written as the
+ * outputEOL, so the line ends are set, and mixed line ends are corrected,
+ * as the text is written without another copy of the text.
+ * UTF-16 output is converted in chunks that end at a line end,
+ * so a UTF-8 character is never split between chunks.
+ *
+ * @param fout          The output stream.
+ * @param out           The formatted text.
+ * @param encoding      The encoding of the output file.
+ */
+void ASConsole::writeOutputText(ostream& fout, const string& out, FileEncoding encoding) const
+{
+	bool isUtf16 = (encoding == UTF_16LE || encoding == UTF_16BE);
+	if (outputEOL == "\n" && !isUtf16)
+	{
+		fout.write(out.data(), out.length());
+		return;
+	}
+	const size_t chunkSize = 65536;		// 64 KB
+	bool isBigEndian = (encoding == UTF_16BE);
+	string utf8Chunk;
+	vector<char> utf16Chunk;
+	size_t lineStart = 0;
+	while (true)
+	{
+		size_t lineEnd = out.find('\n', lineStart);
+		bool isLastLine = (lineEnd == string::npos);
+		if (isLastLine)
+			lineEnd = out.length();
+		if (!isUtf16)
+		{
+			fout.write(out.data() + lineStart, lineEnd - lineStart);
+			if (!isLastLine)
+				fout.write(outputEOL.data(), outputEOL.length());
+		}
+		else
+		{
+			utf8Chunk.append(out, lineStart, lineEnd - lineStart);
+			if (!isLastLine)
+				utf8Chunk.append(outputEOL);
+			if (utf8Chunk.length() >= chunkSize || isLastLine)
+			{
+				utf16Chunk.resize(encode.utf16LengthFromUtf8(utf8Chunk.c_str(), utf8Chunk.length()));
+				size_t utf16Len = encode.utf8ToUtf16(&utf8Chunk[0], utf8Chunk.length(),
+				                                     isBigEndian, utf16Chunk.data());
+				assert(utf16Len <= utf16Chunk.size());
+				fout.write(utf16Chunk.data(), utf16Len);
+				utf8Chunk.clear();
+			}
+		}
+		if (isLastLine)
+			break;
+		lineStart = lineEnd + 1;
+	}
+}
+
+/**
+ * Write the formatted text to a file.
+ * The text is written to a temporary file in the same directory, which is
+ * then renamed over the original file. A reader of the file will see either
+ * the original file or the formatted file, never a partly written file.
+ * The backup file is created as a hard link to the original file. If the
+ * file system cannot link, the original file is renamed to the backup.
+ * The temporary file and the directory are flushed to the disk unless the
+ * no-fsync option is used.
+ * A file with more than one hard link is written in place so the links are
+ * kept. A file is also written in place if the temporary file cannot be
+ * created or cannot be given the permissions and owner of the original.
+ * The backup of a file written in place is a copy. The original file is not
+ * removed if the write fails. A symbolic link is kept by writing the file it
+ * links to. A --jobs worker returns after an error, the error is in workerError.
+ *
+ * @param fileName_     The path and name of the file to be written.
+ * @param encoding      The encoding of the output file.
+ * @param out           The formatted text.
+ */
+void ASConsole::writeFile(const string& fileName_, FileEncoding encoding, const string& out) const
 {
 	// save date accessed and date modified of original file
 	struct stat stBuf;
@@ -2854,34 +4129,89 @@ void ASConsole::writeFile(const string& fileName_, FileEncoding encoding, ostrin
 	if (stat(fileName_.c_str(), &stBuf) == -1)
 		statErr = true;
 
-	// create a backup
+	// the file that is written, a symbolic link is replaced by its target
+	string targetFileName = fileName_;
+#ifndef _WIN32
+	struct stat linkBuf;
+	if (lstat(fileName_.c_str(), &linkBuf) == 0 && S_ISLNK(linkBuf.st_mode))
+	{
+		targetFileName = getFullPathName(fileName_);
+		if (targetFileName.empty())
+		{
+			printErrnoMessage();
+			error("Cannot resolve symbolic link", fileName_.c_str());
+			return;
+		}
+	}
+#endif
+	string origFileName = fileName_ + origSuffix;
 	if (!noBackup)
 	{
-		string origFileName = fileName_ + origSuffix;
-		removeFile(origFileName.c_str(), "Cannot remove pre-existing backup file");
-		renameFile(fileName_.c_str(), origFileName.c_str(), "Cannot create backup file");
+		if (!removeFile(origFileName.c_str(), "Cannot remove pre-existing backup file"))
+			return;
 	}
 
-	// write the output file
-	ofstream fout(fileName_.c_str(), ios::binary | ios::trunc);
-	if (!fout)
-		error("Cannot open output file", fileName_.c_str());
-	if (encoding == UTF_16LE || encoding == UTF_16BE)
-	{
-		// convert utf-8 to utf-16
-		bool isBigEndian = (encoding == UTF_16BE);
-		size_t utf16Size = encode.utf16LengthFromUtf8(out.str().c_str(), out.str().length());
-		char* utf16Out = new char[utf16Size];
-		size_t utf16Len = encode.utf8ToUtf16(const_cast<char*>(out.str().c_str()),
-		                                     out.str().length(), isBigEndian, utf16Out);
-		assert(utf16Len <= utf16Size);
-		fout << string(utf16Out, utf16Len);
-		delete[] utf16Out;
+	// a file with other hard links, or in a directory that cannot be written, is written in place
+	bool isInPlace = !statErr && stBuf.st_nlink > 1;
+	string tempFileName;
+	if (!isInPlace)
+	{
+		tempFileName = getTempFileName(targetFileName);
+		isInPlace = !createTempFile(tempFileName);
+	}
+	if (!isInPlace)
+	{
+		if (!writeFileText(tempFileName, encoding, out, true))
+			return;
+#ifndef _WIN32
+		// the formatted file keeps the permissions and owner of the original
+		// only a privileged user can give a file to another owner or group
+		if (!statErr
+		        && (chmod(tempFileName.c_str(), stBuf.st_mode & 07777) != 0
+		            || chown(tempFileName.c_str(), stBuf.st_uid, stBuf.st_gid) != 0))
+		{
+			errno = 0;
+			remove(tempFileName.c_str());
+			isInPlace = true;
+		}
+#endif
+	}
+	if (!isInPlace)
+	{
+		if (!noBackup)
+		{
+#ifdef _WIN32
+			bool isLinked = CreateHardLink(origFileName.c_str(), targetFileName.c_str(), nullptr) != 0;
+#else
+			bool isLinked = link(targetFileName.c_str(), origFileName.c_str()) == 0;
+#endif
+			if (!isLinked)
+			{
+				errno = 0;
+				if (!renameFile(targetFileName.c_str(), origFileName.c_str(), "Cannot create backup file"))
+				{
+					remove(tempFileName.c_str());
+					return;
+				}
+			}
+		}
+		if (!replaceFile(tempFileName.c_str(), targetFileName.c_str(), "Cannot replace output file"))
+			return;
+#ifndef _WIN32
+		if (!noFsync)
+			syncDirectory(targetFileName);
+#endif
 	}
 	else
-		fout << out.str();
-
-	fout.close();
+	{
+		if (!noBackup)
+		{
+			if (!copyFile(targetFileName.c_str(), origFileName.c_str(), "Cannot create backup file"))
+				return;
+		}
+		if (!writeFileText(targetFileName, encoding, out, false))
+			return;
+	}
 
 	// change date modified to original file date
 	// Embarcadero must be linked with cw32mt not cw32
@@ -2899,12 +4229,61 @@ void ASConsole::writeFile(const string& fileName_, FileEncoding encoding, ostrin
 		}
 		if (statErr)
 		{
-			perror("errno message");
-			(*errorStream) << "*********  Cannot preserve file date" << endl;
+			printErrnoMessage();
+			printWarning("*********  Cannot preserve file date");
 		}
 	}
 }
 
+/**
+ * Write the formatted text to a file and flush it to the disk.
+ * The file is not flushed if the no-fsync option is used.
+ *
+ * @param fileName_     The path and name of the file to be written.
+ * @param encoding      The encoding of the output file.
+ * @param out           The formatted text.
+ * @param isTempFile    Remove the file if the write fails.
+ * @return              false if a --jobs worker had an error.
+ */
+bool ASConsole::writeFileText(const string& fileName_, FileEncoding encoding, const string& out,
+                              bool isTempFile) const
+{
+	ofstream fout(fileName_.c_str(), ios::binary | ios::trunc);
+	if (!fout)
+	{
+		error("Cannot open output file", fileName_.c_str());
+		return false;
+	}
+	writeOutputText(fout, out, encoding);
+	fout.close();
+	if (!fout)
+	{
+		if (isTempFile)
+			remove(fileName_.c_str());
+		error("Cannot write output file", fileName_.c_str());
+		return false;
+	}
+	if (noFsync)
+		return true;
+#ifdef _WIN32
+	HANDLE hFile = CreateFile(fileName_.c_str(), GENERIC_WRITE, 0, nullptr,
+	                          OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (hFile != INVALID_HANDLE_VALUE)
+	{
+		FlushFileBuffers(hFile);
+		CloseHandle(hFile);
+	}
+#else
+	int fd = open(fileName_.c_str(), O_WRONLY);
+	if (fd != -1)
+	{
+		fsync(fd);
+		close(fd);
+	}
+#endif
+	return true;
+}
+
 #else	// ASTYLE_LIB
 
 //-----------------------------------------------------------------------------
@@ -2956,66 +4335,253 @@ char16_t* ASLibrary::formatUtf16(const char16_t* pSourceIn,		// the source to be
 	return utf16Out;
 }
 
-// STATIC method to allocate temporary memory for AStyle formatting.
-// The data will be converted before being returned to the calling program.
-char* STDCALL ASLibrary::tempMemoryAllocation(unsigned long memoryNeeded)
+// STATIC method to allocate temporary memory for AStyle formatting.
+// The data will be converted before being returned to the calling program.
+char* STDCALL ASLibrary::tempMemoryAllocation(unsigned long memoryNeeded)
+{
+	char* buffer = new (nothrow) char[memoryNeeded];
+	return buffer;
+}
+
+/**
+ * Convert utf-8 strings to utf16 strings.
+ * Memory is allocated by the calling program memory allocation function.
+ * The calling function must check for errors.
+ */
+char16_t* ASLibrary::convertUtf8ToUtf16(const char* utf8In, fpAlloc fpMemoryAlloc) const
+{
+	if (utf8In == nullptr)
+		return nullptr;
+	char* data = const_cast<char*>(utf8In);
+	size_t dataSize = strlen(utf8In);
+	bool isBigEndian = encode.getBigEndian();
+	// return size is in number of CHARs, not char16_t
+	size_t utf16Size = (encode.utf16LengthFromUtf8(data, dataSize) + sizeof(char16_t));
+	char* utf16Out = fpMemoryAlloc((long) utf16Size);
+	if (utf16Out == nullptr)
+		return nullptr;
+#ifdef NDEBUG
+	encode.utf8ToUtf16(data, dataSize + 1, isBigEndian, utf16Out);
+#else
+	size_t utf16Len = encode.utf8ToUtf16(data, dataSize + 1, isBigEndian, utf16Out);
+	assert(utf16Len == utf16Size);
+#endif
+	assert(utf16Size == (encode.utf16len(reinterpret_cast<char16_t*>(utf16Out)) + 1) * sizeof(char16_t));
+	return reinterpret_cast<char16_t*>(utf16Out);
+}
+
+/**
+ * Convert utf16 strings to utf-8.
+ * The calling function must check for errors and delete the
+ * allocated memory.
+ */
+char* ASLibrary::convertUtf16ToUtf8(const char16_t* utf16In) const
+{
+	if (utf16In == nullptr)
+		return nullptr;
+	char* data = reinterpret_cast<char*>(const_cast<char16_t*>(utf16In));
+	// size must be in chars
+	size_t dataSize = encode.utf16len(utf16In) * sizeof(char16_t);
+	bool isBigEndian = encode.getBigEndian();
+	size_t utf8Size = encode.utf8LengthFromUtf16(data, dataSize, isBigEndian) + 1;
+	char* utf8Out = new (nothrow) char[utf8Size];
+	if (utf8Out == nullptr)
+		return nullptr;
+#ifdef NDEBUG
+	encode.utf16ToUtf8(data, dataSize + 1, isBigEndian, utf8Out);
+#else
+	size_t utf8Len = encode.utf16ToUtf8(data, dataSize + 1, isBigEndian, utf8Out);
+	assert(utf8Len == utf8Size);
+#endif
+	assert(utf8Size == strlen(utf8Out) + 1);
+	return utf8Out;
+}
+
+//-----------------------------------------------------------------------------
+// ASLibraryFormatter class
+// used by the AStyleCreate handle and by AStyleMain
+//-----------------------------------------------------------------------------
+
+// the formatter from the previous AStyleMain call in each thread
+thread_local unique_ptr<ASLibraryFormatter> ASLibraryFormatter::threadFormatter;
+
+ASLibraryFormatter::ASLibraryFormatter(fpError fpErrorHandler_, fpAlloc fpMemoryAlloc_)
+	: fpErrorHandler(fpErrorHandler_), fpMemoryAlloc(fpMemoryAlloc_),
+	  fpErrorHandlerContext(nullptr), fpMemoryAllocContext(nullptr), context(nullptr),
+	  hasValidOptions(false)
+{ }
+
+ASLibraryFormatter::ASLibraryFormatter(fpErrorContext fpErrorHandler_, fpAllocContext fpMemoryAlloc_,
+                                       void* context_)
+	: fpErrorHandler(nullptr), fpMemoryAlloc(nullptr),
+	  fpErrorHandlerContext(fpErrorHandler_), fpMemoryAllocContext(fpMemoryAlloc_), context(context_),
+	  hasValidOptions(false)
+{ }
+
+/**
+ * Get the formatter kept by this thread if it was given the same options.
+ * The formatter is removed from the thread while it is used, so an
+ * AStyleMain call from one of the callback functions gets its own formatter.
+ * The formatter must be returned with releaseThreadFormatter().
+ *
+ * @param pOptions    the AStyle options.
+ * @return            the formatter, or nullptr if a new one is needed.
+ */
+ASLibraryFormatter* ASLibraryFormatter::acquireThreadFormatter(const char* pOptions)
+{
+	if (threadFormatter == nullptr || threadFormatter->options != pOptions)
+		return nullptr;
+	return threadFormatter.release();
+}
+
+/**
+ * Keep a formatter for the next AStyleMain call in this thread.
+ * It replaces the formatter that is kept. A formatter with options
+ * errors is deleted, so the errors are reported on the next call.
+ * An output buffer over maxKeptBufferSize is released, so one large
+ * file does not keep its memory for the life of the thread.
+ * The formatter and its buffers are deleted when the thread exits.
+ */
+void ASLibraryFormatter::releaseThreadFormatter(ASLibraryFormatter* libraryFormatter)
+{
+	if (!libraryFormatter->hasValidOptions)
+	{
+		delete libraryFormatter;
+		return;
+	}
+	if (libraryFormatter->textOut.capacity() > maxKeptBufferSize)
+		string().swap(libraryFormatter->textOut);
+	threadFormatter.reset(libraryFormatter);
+}
+
+// the capacity of the output buffer kept by this thread, for testing
+size_t ASLibraryFormatter::getThreadBufferCapacity()
+{
+	if (threadFormatter == nullptr)
+		return 0;
+	return threadFormatter->textOut.capacity();
+}
+
+// replace the functions that were given to the constructor
+void ASLibraryFormatter::setCallbacks(fpError fpErrorHandler_, fpAlloc fpMemoryAlloc_)
+{
+	fpErrorHandler = fpErrorHandler_;
+	fpMemoryAlloc = fpMemoryAlloc_;
+	fpErrorHandlerContext = nullptr;
+	fpMemoryAllocContext = nullptr;
+	context = nullptr;
+}
+
+// replace the functions and context that were given to the constructor
+void ASLibraryFormatter::setCallbacks(fpErrorContext fpErrorHandler_, fpAllocContext fpMemoryAlloc_,
+                                      void* context_)
+{
+	fpErrorHandler = nullptr;
+	fpMemoryAlloc = nullptr;
+	fpErrorHandlerContext = fpErrorHandler_;
+	fpMemoryAllocContext = fpMemoryAlloc_;
+	context = context_;
+}
+
+// call the memory allocation function that was given to the constructor
+char* ASLibraryFormatter::allocateMemory(unsigned long memoryNeeded) const
+{
+	if (fpMemoryAllocContext != nullptr)
+		return fpMemoryAllocContext(context, memoryNeeded);
+	return fpMemoryAlloc(memoryNeeded);
+}
+
+// call the error handler function that was given to the constructor
+void ASLibraryFormatter::reportError(int errorNumber, const char* errorMessage) const
 {
-	char* buffer = new (nothrow) char[memoryNeeded];
-	return buffer;
+	if (fpErrorHandlerContext != nullptr)
+		fpErrorHandlerContext(context, errorNumber, errorMessage);
+	else
+		fpErrorHandler(errorNumber, errorMessage);
 }
 
 /**
- * Convert utf-8 strings to utf16 strings.
- * Memory is allocated by the calling program memory allocation function.
- * The calling function must check for errors.
+ * Parse the options into the formatter.
+ * The options errors are sent to the error handler.
+ *
+ * @param pOptions    the AStyle options.
+ * @return            true if no errors, false if errors.
  */
-char16_t* ASLibrary::convertUtf8ToUtf16(const char* utf8In, fpAlloc fpMemoryAlloc) const
+bool ASLibraryFormatter::setOptions(const char* pOptions)
 {
-	if (utf8In == nullptr)
-		return nullptr;
-	char* data = const_cast<char*>(utf8In);
-	size_t dataSize = strlen(utf8In);
-	bool isBigEndian = encode.getBigEndian();
-	// return size is in number of CHARs, not char16_t
-	size_t utf16Size = (encode.utf16LengthFromUtf8(data, dataSize) + sizeof(char16_t));
-	char* utf16Out = fpMemoryAlloc((long) utf16Size);
-	if (utf16Out == nullptr)
-		return nullptr;
-#ifdef NDEBUG
-	encode.utf8ToUtf16(data, dataSize + 1, isBigEndian, utf16Out);
-#else
-	size_t utf16Len = encode.utf8ToUtf16(data, dataSize + 1, isBigEndian, utf16Out);
-	assert(utf16Len == utf16Size);
-#endif
-	assert(utf16Size == (encode.utf16len(reinterpret_cast<char16_t*>(utf16Out)) + 1) * sizeof(char16_t));
-	return reinterpret_cast<char16_t*>(utf16Out);
+	ASOptions parser(formatter);
+	vector<string> optionsVector;
+	stringstream opt(pOptions);
+	parser.importOptions(opt, optionsVector);
+	bool ok = parser.parseOptions(optionsVector, "Invalid Artistic Style options:");
+	if (!ok)
+		reportError(130, parser.getOptionErrors().c_str());
+	options = pOptions;
+	hasValidOptions = ok;
+	return ok;
 }
 
 /**
- * Convert utf16 strings to utf-8.
- * The calling function must check for errors and delete the
- * allocated memory.
+ * Format the source text with the current options.
+ * The text is built in a reused buffer and copied once to the
+ * memory allocated by the calling program.
+ *
+ * @param pSourceIn         the source to be formatted, need not be NUL terminated.
+ * @param sourceLength      the length of the source.
+ * @param pTextLengthOut    receives the length of the output, may be nullptr.
+ * @return                  the NUL terminated output, or nullptr if an error.
  */
-char* ASLibrary::convertUtf16ToUtf8(const char16_t* utf16In) const
+char* ASLibraryFormatter::format(const char* pSourceIn, size_t sourceLength,
+                                 unsigned long* pTextLengthOut)
 {
-	if (utf16In == nullptr)
+	if (pSourceIn == nullptr)
+	{
+		reportError(101, "No pointer to source input.");
 		return nullptr;
-	char* data = reinterpret_cast<char*>(const_cast<char16_t*>(utf16In));
-	// size must be in chars
-	size_t dataSize = encode.utf16len(utf16In) * sizeof(char16_t);
-	bool isBigEndian = encode.getBigEndian();
-	size_t utf8Size = encode.utf8LengthFromUtf16(data, dataSize, isBigEndian) + 1;
-	char* utf8Out = new (nothrow) char[utf8Size];
-	if (utf8Out == nullptr)
+	}
+	ASBufferIterator streamIterator(pSourceIn, sourceLength);
+	textOut.clear();
+	textOut.reserve(sourceLength + sourceLength / 8);
+	formatter.init(&streamIterator);
+
+	while (formatter.hasMoreLines())
+	{
+		textOut.append(formatter.nextLine());
+		if (formatter.hasMoreLines())
+			textOut.append(streamIterator.getOutputEOL());
+		else
+		{
+			// this can happen if the file if missing a closing brace and break-blocks is requested
+			if (formatter.getIsLineReady())
+			{
+				textOut.append(streamIterator.getOutputEOL());
+				textOut.append(formatter.nextLine());
+			}
+		}
+	}
+
+	size_t textSizeOut = textOut.length();
+	char* pTextOut = allocateMemory((long) textSizeOut + 1);     // call memory allocation function
+	if (pTextOut == nullptr)
+	{
+		reportError(120, "Allocation failure on output.");
 		return nullptr;
-#ifdef NDEBUG
-	encode.utf16ToUtf8(data, dataSize + 1, isBigEndian, true, utf8Out);
-#else
-	size_t utf8Len = encode.utf16ToUtf8(data, dataSize + 1, isBigEndian, true, utf8Out);
-	assert(utf8Len == utf8Size);
+	}
+
+	memcpy(pTextOut, textOut.data(), textSizeOut);
+	pTextOut[textSizeOut] = '\0';
+	if (pTextLengthOut != nullptr)
+		*pTextLengthOut = (unsigned long) textSizeOut;
+#ifndef NDEBUG
+	// The checksum is an assert in the console build and ASFormatter.
+	// This error returns the incorrectly formatted file to the editor.
+	// This is done to allow the file to be saved for debugging purposes.
+	if (formatter.getChecksumDiff() != 0)
+		reportError(220,
+		            "Checksum error.\n"
+		            "The incorrectly formatted file will be returned for debugging.");
 #endif
-	assert(utf8Size == strlen(utf8Out) + 1);
-	return utf8Out;
+	return pTextOut;
 }
 
 #endif	// ASTYLE_LIB
@@ -3090,6 +4656,11 @@ bool ASOptions::parseOptions(vector<string>& optionsVector, const string& errorI
 
 void ASOptions::parseOption(const string& arg, const string& errorInfo)
 {
+#ifndef ASTYLE_LIB
+	if (parseConsoleOption(arg, errorInfo))
+		return;
+	formatterOptions.emplace_back(arg);
+#endif
 	if (isOption(arg, "A1", "style=allman") || isOption(arg, "style=bsd") || isOption(arg, "style=break"))
 	{
 		formatter.setFormattingStyle(STYLE_ALLMAN);
@@ -3645,7 +5216,49 @@ bool ASOptions::parseOptionContinued(const string& arg, const string& errorInfo)
 	return true;
 #else
 	// Options used by only console ///////////////////////////////////////////////////////////////
-	else if (isOption(arg, "n", "suffix=none"))
+	// the options that do not change the formatting are in parseConsoleOption()
+	else if (isOption(arg, "lineend=windows"))
+	{
+		formatter.setLineEndFormat(LINEEND_WINDOWS);
+	}
+	else if (isOption(arg, "lineend=linux"))
+	{
+		formatter.setLineEndFormat(LINEEND_LINUX);
+	}
+	else if (isOption(arg, "lineend=macold"))
+	{
+		formatter.setLineEndFormat(LINEEND_MACOLD);
+	}
+	else if (isParamOption(arg, "z"))
+	{
+		int lineendType = 0;
+		string lineendParam = getParam(arg, "z");
+		if (lineendParam.length() > 0)
+			lineendType = atoi(lineendParam.c_str());
+		if (lineendType < 1 || lineendType > 3)
+			isOptionError(arg, errorInfo);
+		else if (lineendType == 1)
+			formatter.setLineEndFormat(LINEEND_WINDOWS);
+		else if (lineendType == 2)
+			formatter.setLineEndFormat(LINEEND_LINUX);
+		else if (lineendType == 3)
+			formatter.setLineEndFormat(LINEEND_MACOLD);
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+#endif
+}	// End of parseOptionContinued function
+
+#ifndef ASTYLE_LIB
+// Parse the console options that do not change the formatted text.
+// They are not saved in formatterOptions, so they do not change the --cache hash.
+// Return 'true' if the option was found and processed.
+bool ASOptions::parseConsoleOption(const string& arg, const string& errorInfo)
+{
+	if (isOption(arg, "n", "suffix=none"))
 	{
 		console.setNoBackup(true);
 	}
@@ -3699,40 +5312,36 @@ bool ASOptions::parseOptionContinued(const string& arg, const string& errorInfo)
 	{
 		console.setErrorStream(&cout);
 	}
-	else if (isOption(arg, "lineend=windows"))
-	{
-		formatter.setLineEndFormat(LINEEND_WINDOWS);
-	}
-	else if (isOption(arg, "lineend=linux"))
+	else if (isOption(arg, "cache"))
 	{
-		formatter.setLineEndFormat(LINEEND_LINUX);
+		console.setUseCache(true);
 	}
-	else if (isOption(arg, "lineend=macold"))
+	else if (isOption(arg, "no-fsync"))
 	{
-		formatter.setLineEndFormat(LINEEND_MACOLD);
+		console.setNoFsync(true);
 	}
-	else if (isParamOption(arg, "z"))
+	else if (isParamOption(arg, "jobs="))
 	{
-		int lineendType = 0;
-		string lineendParam = getParam(arg, "z");
-		if (lineendParam.length() > 0)
-			lineendType = atoi(lineendParam.c_str());
-		if (lineendType < 1 || lineendType > 3)
+		int jobs = -1;
+		string jobsParam = getParam(arg, "jobs=");
+		if (jobsParam.length() > 0
+		        && jobsParam.find_first_not_of("0123456789") == string::npos)
+			jobs = atoi(jobsParam.c_str());
+		// zero uses the number of processors
+		if (jobs == 0)
+			jobs = min(max(static_cast<int>(thread::hardware_concurrency()), 1), 256);
+		if (jobs < 1 || jobs > 256)
 			isOptionError(arg, errorInfo);
-		else if (lineendType == 1)
-			formatter.setLineEndFormat(LINEEND_WINDOWS);
-		else if (lineendType == 2)
-			formatter.setLineEndFormat(LINEEND_LINUX);
-		else if (lineendType == 3)
-			formatter.setLineEndFormat(LINEEND_MACOLD);
+		else
+			console.setNumJobs(jobs);
 	}
 	else
 	{
 		return false;
 	}
 	return true;
+}
 #endif
-}	// End of parseOptionContinued function
 
 // Parse options from the option file.
 void ASOptions::importOptions(stringstream& in, vector<string>& optionsVector)
@@ -3783,6 +5392,14 @@ void ASOptions::importOptions(stringstream& in, vector<string>& optionsVector)
 	}
 }
 
+#ifndef ASTYLE_LIB
+// the options parsed, in order, without the console options
+vector<string> ASOptions::getFormatterOptions() const
+{
+	return formatterOptions;
+}
+#endif
+
 string ASOptions::getOptionErrors() const
 {
 	return optionErrors.str();
@@ -3996,8 +5613,9 @@ size_t ASEncoding::utf16LengthFromUtf8(const char* utf8In, size_t len) const
 // Copyright (C) 2002 Scott Kirkwood.
 // Modified for Artistic Style by Jim Pattee.
 // Convert a utf-16 file to utf-8.
-size_t ASEncoding::utf16ToUtf8(char* utf16In, size_t inLen, bool isBigEndian,
-                               bool firstBlock, char* utf8Out) const
+// The output for the last character is completed before returning,
+// so no state is retained between calls.
+size_t ASEncoding::utf16ToUtf8(char* utf16In, size_t inLen, bool isBigEndian, char* utf8Out) const
 {
 	int nCur16 = 0;
 	int nCur = 0;
@@ -4005,12 +5623,10 @@ size_t ASEncoding::utf16ToUtf8(char* utf16In, size_t inLen, bool isBigEndian,
 	ubyte* pCur = reinterpret_cast<ubyte*>(utf8Out);
 	const ubyte* pEnd = pRead + inLen;
 	const ubyte* pCurStart = pCur;
-	static eState state = eStart;	// state is retained for subsequent blocks
-	if (firstBlock)
-		state = eStart;
+	eState state = eStart;
 
 	// the BOM will automatically be converted to utf-8
-	while (pRead < pEnd)
+	while (pRead < pEnd || state != eStart)
 	{
 		switch (state)
 		{
@@ -4102,6 +5718,15 @@ using namespace astyle;
 
 #ifdef ASTYLE_JNI
 
+// the java objects for the error handler, passed as the callback context
+// so that several java threads can call AStyleMain concurrently
+struct JavaContext
+{
+	JNIEnv*   env;
+	jobject   obj;
+	jmethodID mid;
+};
+
 // called by a java program to get the version number
 // the function name is constructed from method names in the calling java program
 extern "C"  EXPORT
@@ -4118,15 +5743,16 @@ jstring STDCALL Java_AStyleInterface_AStyleMain(JNIEnv* env,
                                                 jstring textInJava,
                                                 jstring optionsJava)
 {
-	g_env = env;                                // make object available globally
-	g_obj = obj;                                // make object available globally
+	JavaContext context;
+	context.env = env;
+	context.obj = obj;
 
 	jstring textErr = env->NewStringUTF("");    // zero length text returned if an error occurs
 
 	// get the method ID
 	jclass cls = env->GetObjectClass(obj);
-	g_mid = env->GetMethodID(cls, "ErrorHandler", "(ILjava/lang/String;)V");
-	if (g_mid == nullptr)
+	context.mid = env->GetMethodID(cls, "ErrorHandler", "(ILjava/lang/String;)V");
+	if (context.mid == nullptr)
 	{
 		cout << "Cannot find java method ErrorHandler" << endl;
 		return textErr;
@@ -4137,7 +5763,7 @@ jstring STDCALL Java_AStyleInterface_AStyleMain(JNIEnv* env,
 	const char* options = env->GetStringUTFChars(optionsJava, nullptr);
 
 	// call the C++ formatting function
-	char* textOut = AStyleMain(textIn, options, javaErrorHandler, javaMemoryAlloc);
+	char* textOut = AStyleMainContext(textIn, options, javaErrorHandler, javaMemoryAlloc, &context);
 	// if an error message occurred it was displayed by errorHandler
 	if (textOut == nullptr)
 		return textErr;
@@ -4152,14 +5778,15 @@ jstring STDCALL Java_AStyleInterface_AStyleMain(JNIEnv* env,
 }
 
 // Call the Java error handler
-void STDCALL javaErrorHandler(int errorNumber, const char* errorMessage)
+void STDCALL javaErrorHandler(void* context, int errorNumber, const char* errorMessage)
 {
-	jstring errorMessageJava = g_env->NewStringUTF(errorMessage);
-	g_env->CallVoidMethod(g_obj, g_mid, errorNumber, errorMessageJava);
+	JavaContext* java = static_cast<JavaContext*>(context);
+	jstring errorMessageJava = java->env->NewStringUTF(errorMessage);
+	java->env->CallVoidMethod(java->obj, java->mid, errorNumber, errorMessageJava);
 }
 
 // Allocate memory for the formatted text
-char* STDCALL javaMemoryAlloc(unsigned long memoryNeeded)
+char* STDCALL javaMemoryAlloc(void*, unsigned long memoryNeeded)
 {
 	// error condition is checked after return from AStyleMain
 	char* buffer = new (nothrow) char[memoryNeeded];
@@ -4226,6 +5853,8 @@ extern "C" EXPORT char16_t* STDCALL AStyleMainUtf16(const char16_t* pSourceIn,	/
 // ASTYLE_LIB entry point for library builds
 //----------------------------------------------------------------------------
 /*
+ * Each thread keeps the formatter from its previous call. It is reused,
+ * without parsing the options again, when the options are the same.
  * IMPORTANT Visual C DLL linker for WIN32 must have the additional options:
  *           /EXPORT:AStyleMain=_AStyleMain@16
  *           /EXPORT:AStyleMainUtf16=_AStyleMainUtf16@16
@@ -4256,63 +5885,181 @@ extern "C" EXPORT char* STDCALL AStyleMain(const char* pSourceIn,		// the source
 		return nullptr;
 	}
 
-	ASFormatter formatter;
-	ASOptions options(formatter);
-
-	vector<string> optionsVector;
-	stringstream opt(pOptions);
-
-	options.importOptions(opt, optionsVector);
+	// the formatter of the previous call is reused if the options are the same
+	ASLibraryFormatter* libraryFormatter = ASLibraryFormatter::acquireThreadFormatter(pOptions);
+	if (libraryFormatter != nullptr)
+		libraryFormatter->setCallbacks(fpErrorHandler, fpMemoryAlloc);
+	else
+	{
+		libraryFormatter = new (nothrow) ASLibraryFormatter(fpErrorHandler, fpMemoryAlloc);
+		if (libraryFormatter == nullptr)
+		{
+			fpErrorHandler(120, "Allocation failure on formatter.");
+			return nullptr;
+		}
+		// an options error is reported and the source is still formatted
+		libraryFormatter->setOptions(pOptions);
+	}
+	char* textOut = libraryFormatter->format(pSourceIn, strlen(pSourceIn), nullptr);
+	ASLibraryFormatter::releaseThreadFormatter(libraryFormatter);
+	return textOut;
+}
 
-	bool ok = options.parseOptions(optionsVector, "Invalid Artistic Style options:");
-	if (!ok)
-		fpErrorHandler(130, options.getOptionErrors().c_str());
+/*
+ * AStyleMainContext is the same as AStyleMain except that the calling
+ * program context pointer is passed to the error handler and memory
+ * allocation functions. It may be called concurrently from several threads.
+ * IMPORTANT Visual C DLL linker for WIN32 must have the additional option:
+ *           /EXPORT:AStyleMainContext=_AStyleMainContext@20
+ */
+extern "C" EXPORT char* STDCALL AStyleMainContext(const char* pSourceIn,			// the source to be formatted
+                                                  const char* pOptions,				// AStyle options
+                                                  fpErrorContext fpErrorHandler,	// error handler function
+                                                  fpAllocContext fpMemoryAlloc,		// memory allocation function
+                                                  void* context)					// passed to the functions
+{
+	if (fpErrorHandler == nullptr)         // cannot display a message if no error handler
+		return nullptr;
 
-	stringstream in(pSourceIn);
-	ASStreamIterator<stringstream> streamIterator(&in);
-	ostringstream out;
-	formatter.init(&streamIterator);
+	if (pSourceIn == nullptr)
+	{
+		fpErrorHandler(context, 101, "No pointer to source input.");
+		return nullptr;
+	}
+	if (pOptions == nullptr)
+	{
+		fpErrorHandler(context, 102, "No pointer to AStyle options.");
+		return nullptr;
+	}
+	if (fpMemoryAlloc == nullptr)
+	{
+		fpErrorHandler(context, 103, "No pointer to memory allocation function.");
+		return nullptr;
+	}
 
-	while (formatter.hasMoreLines())
+	// the formatter of the previous call is reused if the options are the same
+	ASLibraryFormatter* libraryFormatter = ASLibraryFormatter::acquireThreadFormatter(pOptions);
+	if (libraryFormatter != nullptr)
+		libraryFormatter->setCallbacks(fpErrorHandler, fpMemoryAlloc, context);
+	else
 	{
-		out << formatter.nextLine();
-		if (formatter.hasMoreLines())
-			out << streamIterator.getOutputEOL();
-		else
+		libraryFormatter = new (nothrow) ASLibraryFormatter(fpErrorHandler, fpMemoryAlloc, context);
+		if (libraryFormatter == nullptr)
 		{
-			// this can happen if the file if missing a closing brace and break-blocks is requested
-			if (formatter.getIsLineReady())
-			{
-				out << streamIterator.getOutputEOL();
-				out << formatter.nextLine();
-			}
+			fpErrorHandler(context, 120, "Allocation failure on formatter.");
+			return nullptr;
 		}
+		// an options error is reported and the source is still formatted
+		libraryFormatter->setOptions(pOptions);
 	}
+	char* textOut = libraryFormatter->format(pSourceIn, strlen(pSourceIn), nullptr);
+	ASLibraryFormatter::releaseThreadFormatter(libraryFormatter);
+	return textOut;
+}
 
-	size_t textSizeOut = out.str().length();
-	char* pTextOut = fpMemoryAlloc((long) textSizeOut + 1);     // call memory allocation function
-	if (pTextOut == nullptr)
+extern "C" EXPORT const char* STDCALL AStyleGetVersion(void)
+{
+	return g_version;
+}
+
+//----------------------------------------------------------------------------
+// ASTYLE_LIB entry points for a reusable formatter handle
+//----------------------------------------------------------------------------
+/*
+ * The options are parsed once by AStyleCreate and the handle may be used
+ * for any number of AStyleFormat calls. A handle must not be used by more
+ * than one thread at a time.
+ * IMPORTANT Visual C DLL linker for WIN32 must have the additional options:
+ *           /EXPORT:AStyleCreate=_AStyleCreate@12
+ *           /EXPORT:AStyleFormat=_AStyleFormat@16
+ *           /EXPORT:AStyleDestroy=_AStyleDestroy@4
+ * No /EXPORT is required for x64
+ */
+extern "C" EXPORT AStyleHandle STDCALL AStyleCreate(const char* pOptions,		// AStyle options
+                                                    fpError fpErrorHandler,		// error handler function
+                                                    fpAlloc fpMemoryAlloc)		// memory allocation function
+{
+	if (fpErrorHandler == nullptr)         // cannot display a message if no error handler
+		return nullptr;
+
+	if (pOptions == nullptr)
 	{
-		fpErrorHandler(120, "Allocation failure on output.");
+		fpErrorHandler(102, "No pointer to AStyle options.");
+		return nullptr;
+	}
+	if (fpMemoryAlloc == nullptr)
+	{
+		fpErrorHandler(103, "No pointer to memory allocation function.");
 		return nullptr;
 	}
 
-	strcpy(pTextOut, out.str().c_str());
-#ifndef NDEBUG
-	// The checksum is an assert in the console build and ASFormatter.
-	// This error returns the incorrectly formatted file to the editor.
-	// This is done to allow the file to be saved for debugging purposes.
-	if (formatter.getChecksumDiff() != 0)
-		fpErrorHandler(220,
-		               "Checksum error.\n"
-		               "The incorrectly formatted file will be returned for debugging.");
-#endif
-	return pTextOut;
+	ASLibraryFormatter* libraryFormatter = new (nothrow) ASLibraryFormatter(fpErrorHandler, fpMemoryAlloc);
+	if (libraryFormatter == nullptr)
+	{
+		fpErrorHandler(120, "Allocation failure on formatter.");
+		return nullptr;
+	}
+	if (!libraryFormatter->setOptions(pOptions))
+	{
+		delete libraryFormatter;
+		return nullptr;
+	}
+	return libraryFormatter;
 }
 
-extern "C" EXPORT const char* STDCALL AStyleGetVersion(void)
+/*
+ * AStyleCreateContext is the same as AStyleCreate except that the calling
+ * program context pointer is passed to the error handler and memory
+ * allocation functions.
+ * IMPORTANT Visual C DLL linker for WIN32 must have the additional option:
+ *           /EXPORT:AStyleCreateContext=_AStyleCreateContext@16
+ */
+extern "C" EXPORT AStyleHandle STDCALL AStyleCreateContext(const char* pOptions,				// AStyle options
+                                                           fpErrorContext fpErrorHandler,	// error handler function
+                                                           fpAllocContext fpMemoryAlloc,	// memory allocation function
+                                                           void* context)					// passed to the functions
 {
-	return g_version;
+	if (fpErrorHandler == nullptr)         // cannot display a message if no error handler
+		return nullptr;
+
+	if (pOptions == nullptr)
+	{
+		fpErrorHandler(context, 102, "No pointer to AStyle options.");
+		return nullptr;
+	}
+	if (fpMemoryAlloc == nullptr)
+	{
+		fpErrorHandler(context, 103, "No pointer to memory allocation function.");
+		return nullptr;
+	}
+
+	ASLibraryFormatter* libraryFormatter = new (nothrow) ASLibraryFormatter(fpErrorHandler, fpMemoryAlloc, context);
+	if (libraryFormatter == nullptr)
+	{
+		fpErrorHandler(context, 120, "Allocation failure on formatter.");
+		return nullptr;
+	}
+	if (!libraryFormatter->setOptions(pOptions))
+	{
+		delete libraryFormatter;
+		return nullptr;
+	}
+	return libraryFormatter;
+}
+
+extern "C" EXPORT char* STDCALL AStyleFormat(AStyleHandle handle,				// from AStyleCreate
+                                             const char* pSourceIn,				// the source to be formatted
+                                             unsigned long sourceLength,		// length of the source
+                                             unsigned long* pTextLengthOut)		// length of the output
+{
+	if (handle == nullptr)                 // cannot display a message without the error handler
+		return nullptr;
+	return handle->format(pSourceIn, sourceLength, pTextLengthOut);
+}
+
+extern "C" EXPORT void STDCALL AStyleDestroy(AStyleHandle handle)
+{
+	delete handle;
 }
 
 // ASTYLECON_LIB is defined to exclude "main" from the test programs
@@ -40,6 +40,13 @@
 #ifndef ASTYLE_LIB
 	// for console build only
 	#include "ASLocalizer.h"
+	#include <atomic>
+	#include <condition_variable>
+	#include <cstdint>
+	#include <deque>
+	#include <mutex>
+	#include <thread>
+	#include <unordered_map>
 	#define _(a) localizer.settext(a)
 #endif	// ASTYLE_LIB
 
@@ -84,6 +91,9 @@
 	// define pointers to callback error handler and memory allocation
 	typedef void (STDCALL* fpError)(int errorNumber, const char* errorMessage);
 	typedef char* (STDCALL* fpAlloc)(unsigned long memoryNeeded);
+	// the same callbacks with a calling program context pointer
+	typedef void (STDCALL* fpErrorContext)(void* context, int errorNumber, const char* errorMessage);
+	typedef char* (STDCALL* fpAllocContext)(void* context, unsigned long memoryNeeded);
 #endif  // #ifdef ASTYLE_LIB
 
 //----------------------------------------------------------------------------
@@ -93,38 +103,45 @@
 namespace astyle {
 //
 //----------------------------------------------------------------------------
-// ASStreamIterator class
-// typename will be stringstream for AStyle
-// it could be istream for plug-ins
+// ASLineIterator class
+// the line end detection and the peek state shared by the iterators below
+// the derived class reads the input with the protected virtual functions
 // ASSourceIterator is an inherited abstract class defined in astyle.h
 //----------------------------------------------------------------------------
 
-template<typename T>
-class ASStreamIterator : public ASSourceIterator
+class ASLineIterator : public ASSourceIterator
 {
 public:
 	bool checkForEmptyLine;
 
 public:	// function declarations
-	explicit ASStreamIterator(T* in);
-	~ASStreamIterator() override;
+	ASLineIterator();
+	~ASLineIterator() override;
 	bool getLineEndChange(int lineEndFormat) const;
-	int  getStreamLength() const override;
-	string nextLine(bool emptyLineWasDeleted) override;
-	string peekNextLine() override;
+	string nextLine(bool emptyLineWasDeleted) override
+	{ return nextLineRef(emptyLineWasDeleted); }
+	string peekNextLine() override
+	{ return peekNextLineRef(); }
+	const string& nextLineRef(bool emptyLineWasDeleted) override;
+	const string& peekNextLineRef() override;
 	void peekReset() override;
 	void saveLastInputLine();
-	streamoff tellg() override;
+
+protected:	// functions for reading the input
+	virtual int  peekChar() = 0;
+	virtual bool readLine(string& line, char& lineEndCh) = 0;
+	virtual void seekPeekStart(streamoff pos) = 0;
+	virtual void setEndOfInput() = 0;
+	virtual void skipChar() = 0;
 
 private:
-	T* inStream;            // pointer to the input stream
 	string buffer;          // current input line
 	string prevBuffer;      // previous input line
+	string peekBuffer;      // line returned by peekNextLine
 	string outputEOL;       // next output end of line char
 	int eolWindows;         // number of Windows line endings, CRLF
 	int eolLinux;           // number of Linux line endings, LF
 	int eolMacOld;          // number of old Mac line endings. CR
-	streamoff streamLength; // length of the input file stream
 	streamoff peekStart;    // starting position for peekNextLine
 	bool prevLineDeleted;   // the previous input line was deleted
 
@@ -133,9 +150,77 @@ public:	// inline functions
 	{ return (nextLine_ == prevBuffer); }
 	const string& getOutputEOL() const { return outputEOL; }
 	streamoff getPeekStart() const override { return peekStart; }
+};
+
+//----------------------------------------------------------------------------
+// ASStreamIterator class
+// typename will be stringstream for AStyle
+// it could be istream for plug-ins
+// ASLineIterator is the base class for the line ends and peeking
+//----------------------------------------------------------------------------
+
+template<typename T>
+class ASStreamIterator : public ASLineIterator
+{
+public:	// function declarations
+	explicit ASStreamIterator(T* in);
+	~ASStreamIterator() override;
+	int  getStreamLength() const override;
+	streamoff tellg() override;
+
+protected:
+	int  peekChar() override;
+	bool readLine(string& line, char& lineEndCh) override;
+	void seekPeekStart(streamoff pos) override;
+	void setEndOfInput() override;
+	void skipChar() override;
+
+private:
+	T* inStream;            // pointer to the input stream
+	streamoff streamLength; // length of the input file stream
+
+public:	// inline functions
 	bool hasMoreLines() const override { return !inStream->eof(); }
 };
 
+//----------------------------------------------------------------------------
+// ASBufferIterator class
+// reads lines from a contiguous block of memory
+// the data is NOT copied and must remain valid while the iterator is used
+// the results are the same as ASStreamIterator<stringstream> for the same text
+// ASLineIterator is the base class for the line ends and peeking
+//----------------------------------------------------------------------------
+
+class ASBufferIterator : public ASLineIterator
+{
+public:	// function declarations
+	ASBufferIterator(const char* data, size_t dataLength);
+	~ASBufferIterator() override;
+	int  getStreamLength() const override;
+	streamoff tellg() override;
+
+protected:
+	int  peekChar() override;
+	bool readLine(string& line, char& lineEndCh) override;
+	void seekPeekStart(streamoff pos) override;
+	void setEndOfInput() override;
+	void skipChar() override;
+
+private:
+	size_t findLineEnd(size_t lineStart);
+
+private:
+	const char* inData;     // pointer to the input data
+	size_t inLength;        // length of the input data
+	size_t inPos;           // offset of the next character to read
+	bool isEof;             // end of data was reached, the same as istream eof()
+	size_t lfSearchStart;   // start of the last search for a LF
+	size_t lfPos;           // offset of the LF found by the last search, or npos
+
+public:	// inline functions
+	bool hasMoreLines() const override { return !isEof; }
+};
+
 //----------------------------------------------------------------------------
 // ASEncoding class for utf8/16 conversions
 // used by both console and library builds
@@ -161,8 +246,7 @@ public:
 	size_t utf8LengthFromUtf16(const char* utf16In, size_t inLen, bool isBigEndian) const;
 	size_t utf8ToUtf16(char* utf8In, size_t inLen, bool isBigEndian, char* utf16Out) const;
 	size_t utf16LengthFromUtf8(const char* utf8In, size_t len) const;
-	size_t utf16ToUtf8(char* utf16In, size_t inLen, bool isBigEndian,
-	                   bool firstBlock, char* utf8Out) const;
+	size_t utf16ToUtf8(char* utf16In, size_t inLen, bool isBigEndian, char* utf8Out) const;
 };
 
 //----------------------------------------------------------------------------
@@ -178,6 +262,9 @@ public:
 	ASOptions(ASFormatter& formatterArg);
 #else
 	ASOptions(ASFormatter& formatterArg, ASConsole& consoleArg);
+#endif
+#ifndef ASTYLE_LIB
+	vector<string> getFormatterOptions() const;
 #endif
 	string getOptionErrors() const;
 	void importOptions(stringstream& in, vector<string>& optionsVector);
@@ -189,6 +276,7 @@ private:
 	stringstream optionErrors;		// option error messages
 #ifndef ASTYLE_LIB
 	ASConsole&   console;			// DO NOT USE for ASTYLE_LIB
+	vector<string> formatterOptions;	// parsed options except the console options
 #endif
 
 	// functions
@@ -201,10 +289,181 @@ private:
 	bool isParamOption(const string& arg, const char* option1, const char* option2);
 	void parseOption(const string& arg, const string& errorInfo);
 	bool parseOptionContinued(const string& arg, const string& errorInfo);
+#ifndef ASTYLE_LIB
+	bool parseConsoleOption(const string& arg, const string& errorInfo);
+#endif
 };
 
 #ifndef	ASTYLE_LIB
 
+//----------------------------------------------------------------------------
+// ASStreamingIterator class for console build
+// reads lines from a file descriptor, usually stdin, as the input arrives
+// only the current line and the lines being peeked are kept in memory
+// the results are the same as ASStreamIterator<stringstream> for the same text
+// ASLineIterator is the base class for the line ends and peeking
+//----------------------------------------------------------------------------
+
+class ASStreamingIterator : public ASLineIterator
+{
+public:	// function declarations
+	explicit ASStreamingIterator(int fileDescriptor);
+	~ASStreamingIterator() override;
+	int  getStreamLength() const override;
+	streamoff tellg() override;
+
+protected:
+	int  peekChar() override;
+	bool readLine(string& line, char& lineEndCh) override;
+	void seekPeekStart(streamoff pos) override;
+	void setEndOfInput() override;
+	void skipChar() override;
+
+private:
+	size_t findLineEnd(size_t lineStart);
+	bool hasData(size_t pos);
+	bool readMore();
+
+private:
+	int inFd;               // the input file descriptor
+	bool isInputEnded;      // the end of the input was read
+	bool isReadError;       // the input ended because of a read error
+	string window;          // input read but not yet discarded
+	size_t windowPos;       // offset in window of the next character to read
+	streamoff windowStart;  // stream position of the start of window
+	bool isEof;             // end of input was reached, the same as istream eof()
+
+public:	// inline functions
+	bool hasMoreLines() const override { return !isEof; }
+	bool hasReadError() const { return isReadError; }
+};
+
+//----------------------------------------------------------------------------
+// ASMappedFile class for console build
+// maps an input file into memory so it can be read by an ASBufferIterator
+// the mapping must be closed before the file is renamed or removed
+//----------------------------------------------------------------------------
+
+class ASMappedFile
+{
+public:
+	ASMappedFile();
+	~ASMappedFile();
+	ASMappedFile(const ASMappedFile&)            = delete;
+	ASMappedFile& operator=(ASMappedFile const&) = delete;
+	void close();
+	const char* getData() const { return mapData; }
+	size_t getSize() const { return mapSize; }
+	bool open(const string& fileName_);
+
+private:
+	const char* mapData;                // start of the mapped file
+	size_t mapSize;                     // length of the mapped file
+};
+
+//----------------------------------------------------------------------------
+// ASFileCache class for console build
+// the --cache option file of files known to be unchanged by formatting
+// a file is skipped if its text hash and the options hash are unchanged
+// it is shared by the --jobs worker threads
+//----------------------------------------------------------------------------
+
+class ASFileCache
+{
+public:
+	ASFileCache();
+	ASFileCache(const ASFileCache&)            = delete;
+	ASFileCache& operator=(ASFileCache const&) = delete;
+	string getCacheFileName() const { return cacheFileName; }
+	bool isUnchanged(const string& path, uint64_t textHash, int& lines) const;
+	void load(const string& fileName_, uint64_t optionsHash_);
+	bool save() const;
+	void setChanged(const string& path);
+	void setUnchanged(const string& path, uint64_t textHash, int lines);
+	static uint64_t hashText(const char* data, size_t length, uint64_t hash = 0xcbf29ce484222325ULL);
+
+private:
+	struct CacheEntry
+	{
+		uint64_t textHash;              // hash of the unchanged file text
+		int lines;                      // number of lines in the file
+	};
+	mutable mutex cacheMutex;           // protects the entries
+	unordered_map<string, CacheEntry> entries; // cached files by path and name
+	string cacheFileName;               // file path and name of the cache file
+	uint64_t optionsHash;               // hash of the options and version
+	bool isModified;                    // entries must be saved
+};
+
+//----------------------------------------------------------------------------
+// ASFileQueue class for console build
+// a bounded queue of files to be formatted by the --jobs worker threads
+// the results are saved by index so they can be displayed in order
+// an error stops the queue, the files not started are skipped
+//----------------------------------------------------------------------------
+
+class ASFileQueue
+{
+public:
+	explicit ASFileQueue(size_t maxQueued);
+	ASFileQueue(const ASFileQueue&)            = delete;
+	ASFileQueue& operator=(ASFileQueue const&) = delete;
+	void addWorker(thread&& worker);
+	void close();
+	void joinWorkers();
+	bool pop(size_t& index, string& path);
+	void push(size_t index, const string& path);
+	void setError(size_t index, const string& message, const string& warningMessage);
+	void setResult(size_t index, bool isFormatted, const string& warningMessage);
+	void stop();
+	bool waitForResult(size_t index, bool& isFormatted, string& errorMessage,
+	                   string& warningMessage);
+
+private:
+	enum { FILE_PENDING, FILE_UNCHANGED, FILE_FORMATTED, FILE_ERROR, FILE_SKIPPED };
+	mutex queueMutex;                   // protects all of the following
+	condition_variable queueNotEmpty;   // a file was pushed or the queue was closed
+	condition_variable queueNotFull;    // a file was popped
+	condition_variable resultReady;     // a result was saved
+	deque<pair<size_t, string> > files; // files waiting to be formatted
+	vector<int> fileResult;             // result for each index pushed
+	unordered_map<size_t, string> fileError; // error message for each FILE_ERROR index
+	unordered_map<size_t, string> fileWarning; // warning messages for an index that has them
+	size_t maxSize;                     // maximum files waiting in the queue
+	bool isClosed;                      // no more files will be pushed
+	bool isStopped;                     // an error was found, no more files will be formatted
+	vector<thread> workers;             // the worker threads formatting the files
+
+	void skipQueuedFiles();
+};
+
+//----------------------------------------------------------------------------
+// ASExcludeMatcher class for console build
+// a trie of the reversed --exclude paths
+// a path is matched from its last character in one pass over the path
+// instead of comparing it to each exclude
+//----------------------------------------------------------------------------
+
+class ASExcludeMatcher
+{
+public:
+	ASExcludeMatcher();
+	void addExclude(const string& exclude, size_t excludeIndex);
+	size_t findExclude(const string& path) const;
+
+private:
+	struct TrieNode
+	{
+		char   ch;              // character of the exclude, from the end
+		size_t firstChild;      // first node of the next character, or npos
+		size_t nextSibling;     // next node with the same parent, or npos
+		size_t excludeIndex;    // first exclude ending at this node, or npos
+	};
+	vector<TrieNode> nodes;     // the first node is the root
+
+	size_t findChild(size_t parent, char ch) const;
+};
+
 //----------------------------------------------------------------------------
 // ASConsole class for console build
 //----------------------------------------------------------------------------
@@ -220,6 +479,7 @@ private:    // variables
 	bool isRecursive;                   // recursive option
 	bool isDryRun;                      // dry-run option
 	bool noBackup;                      // suffix=none option
+	bool noFsync;                       // no-fsync option
 	bool preserveDate;                  // preserve-date option
 	bool isVerbose;                     // verbose option
 	bool isQuiet;                       // quiet option
@@ -227,9 +487,12 @@ private:    // variables
 	bool ignoreExcludeErrors;           // don't abort on unmatched excludes
 	bool ignoreExcludeErrorsDisplay;    // don't display unmatched excludes
 	bool useAscii;                      // ascii option
+	bool useCache;                      // cache option
+	int  numJobs;                       // jobs= option, number of formatting threads
 	// other variables
 	bool bypassBrowserOpen;             // don't open the browser on html options
 	bool hasWildcard;                   // file name includes a wildcard
+	bool isJobsWorker;                  // a --jobs worker, errors are saved in workerError
 	size_t mainDirectoryLength;         // directory length to be excluded in displays
 	bool filesAreIdentical;             // input and output files are identical
 	int  filesFormatted;                // number of files formatted
@@ -250,17 +513,22 @@ private:    // variables
 
 	vector<string> excludeVector;       // exclude from wildcard hits
 	vector<bool>   excludeHitsVector;   // exclude flags for error reporting
+	ASExcludeMatcher excludeMatcher;    // excludeVector for isPathExclued
 	vector<string> fileNameVector;      // file paths and names from the command line
 	vector<string> optionsVector;       // options from the command line
 	vector<string> projectOptionsVector;// project options from the project options file
 	vector<string> fileOptionsVector;   // options from the options file
+	vector<string> formatterOptionsVector; // options that change the formatting, for getOptionsHash
 	vector<string> fileName;            // files to be processed including path
+	ASFileQueue* fileQueue;             // queue for the --jobs threads, or nullptr
+	ASFileCache* fileCache;             // cache of unchanged files, or nullptr
+	mutable string workerError;         // first error of a --jobs worker, the file is not written
+	mutable string workerWarning;       // warnings of a --jobs worker for the current file
 
 public:     // functions
 	explicit ASConsole(ASFormatter& formatterArg);
 	ASConsole(const ASConsole&)            = delete;
 	ASConsole& operator=(ASConsole const&) = delete;
-	void convertLineEnds(ostringstream& out, int lineEnd);
 	FileEncoding detectEncoding(const char* data, size_t dataSize) const;
 	void error() const;
 	void error(const char* why, const char* what) const;
@@ -279,8 +547,13 @@ public:     // functions
 	bool getIsRecursive() const;
 	bool getIsVerbose() const;
 	bool getLineEndsMixed() const;
+	int  getLinesOut() const;
 	bool getNoBackup() const;
+	bool getNoFsync() const;
+	int  getNumJobs() const;
 	bool getPreserveDate() const;
+	bool getUseCache() const;
+	string getCacheFileName() const;
 	string getLanguageID() const;
 	string getNumberFormat(int num, size_t lcid = 0) const;
 	string getNumberFormat(int num, const char* groupingArg, const char* separator) const;
@@ -302,12 +575,15 @@ public:     // functions
 	void setIsRecursive(bool state);
 	void setIsVerbose(bool state);
 	void setNoBackup(bool state);
+	void setNoFsync(bool state);
+	void setNumJobs(int jobs);
 	void setOptionFileName(const string& name);
 	void setOrigSuffix(const string& suffix);
 	void setPreserveDate(bool state);
 	void setProjectOptionFileName(const string& optfilepath);
 	void setStdPathIn(const string& path);
 	void setStdPathOut(const string& path);
+	void setUseCache(bool state);
 	void standardizePath(string& path, bool removeBeginningSeparator = false) const;
 	bool stringEndsWith(const string& str, const string& suffix) const;
 	void updateExcludeVector(const string& suffixParam);
@@ -320,14 +596,19 @@ public:     // functions
 	vector<string> getFileName() const;
 
 private:	// functions
-	void correctMixedLineEnds(ostringstream& out);
+	bool copyFile(const char* oldFileName, const char* newFileName, const char* errMsg) const;
+	bool createTempFile(const string& fileName_) const;
 	void formatFile(const string& fileName_);
+	void formatFilesParallel(const string& filePath);
+	bool formatFileText(const string& fileName_);
+	uint64_t getOptionsHash() const;
 	string getParentDirectory(const string& absPath) const;
 	string findProjectOptionFilePath(const string& fileName_) const;
 	string getCurrentDirectory(const string& fileName_) const;
 	void getFileNames(const string& directory, const vector<string>& wildcards);
 	void getFilePaths(const string& filePath);
 	string getFullPathName(const string& relativePath) const;
+	string getTempFileName(const string& fileName_) const;
 	string getHtmlInstallPrefix() const;
 	string getParam(const string& arg, const char* op);
 	bool isHomeOrInvalidAbsPath(const string& absPath) const;
@@ -337,21 +618,32 @@ private:	// functions
 	bool isParamOption(const string& arg, const char* option);
 	bool isPathExclued(const string& subPath);
 	void launchDefaultBrowser(const char* filePathIn = nullptr) const;
+	void printErrnoMessage() const;
 	void printHelp() const;
+	void printFileResult(const string& fileName_, bool isFormatted);
 	void printMsg(const char* msg, const string& data) const;
 	void printSeparatingLine() const;
 	void printVerboseHeader() const;
 	void printVerboseStats(clock_t startTime) const;
+	void printWarning(const char* msg) const;
 	FileEncoding readFile(const string& fileName_, stringstream& in) const;
-	void removeFile(const char* fileName_, const char* errMsg) const;
-	void renameFile(const char* oldFileName, const char* newFileName, const char* errMsg) const;
+	bool removeFile(const char* fileName_, const char* errMsg) const;
+	bool renameFile(const char* oldFileName, const char* newFileName, const char* errMsg) const;
+	bool replaceFile(const char* oldFileName, const char* newFileName, const char* errMsg) const;
 	void setOutputEOL(LineEndFormat lineEndFormat, const string& currentEOL);
 	void sleep(int seconds) const;
+	void stopFileQueue() const;
 	int  waitForRemove(const char* newFileName) const;
 	int  wildcmp(const char* wild, const char* data) const;
-	void writeFile(const string& fileName_, FileEncoding encoding, ostringstream& out) const;
+	void writeFile(const string& fileName_, FileEncoding encoding, const string& out) const;
+	bool writeFileText(const string& fileName_, FileEncoding encoding, const string& out,
+	                   bool isTempFile) const;
+	void writeOutputText(ostream& fout, const string& out, FileEncoding encoding) const;
 #ifdef _WIN32
 	void displayLastError();
+#else
+	void getFileNamesAt(int dirFd, const string& directory, const vector<string>& wildcards);
+	void syncDirectory(const string& fileName_) const;
 #endif
 };
 #else	// ASTYLE_LIB
@@ -377,6 +669,44 @@ private:
 	ASEncoding encode;             // file encoding conversion
 };
 
+//----------------------------------------------------------------------------
+// ASLibraryFormatter class for library build
+// holds the parsed options and formatter for the AStyleCreate handle
+// and for the AStyleMain formatter that is kept by each thread
+// there is no shared mutable state, each thread may use its own object
+//----------------------------------------------------------------------------
+
+class ASLibraryFormatter
+{
+public:
+	ASLibraryFormatter(fpError fpErrorHandler_, fpAlloc fpMemoryAlloc_);
+	ASLibraryFormatter(fpErrorContext fpErrorHandler_, fpAllocContext fpMemoryAlloc_, void* context_);
+	static ASLibraryFormatter* acquireThreadFormatter(const char* pOptions);
+	static void releaseThreadFormatter(ASLibraryFormatter* libraryFormatter);
+	static size_t getThreadBufferCapacity();
+	void  setCallbacks(fpError fpErrorHandler_, fpAlloc fpMemoryAlloc_);
+	void  setCallbacks(fpErrorContext fpErrorHandler_, fpAllocContext fpMemoryAlloc_, void* context_);
+	bool  setOptions(const char* pOptions);
+	char* format(const char* pSourceIn, size_t sourceLength, unsigned long* pTextLengthOut);
+
+private:
+	char* allocateMemory(unsigned long memoryNeeded) const;
+	void  reportError(int errorNumber, const char* errorMessage) const;
+
+private:
+	static thread_local unique_ptr<ASLibraryFormatter> threadFormatter;	// kept by AStyleMain
+	static const size_t maxKeptBufferSize = 1024 * 1024;	// larger buffers are not kept by the thread
+	ASFormatter formatter;                  // reused for each call to format
+	fpError fpErrorHandler;                 // error handler function
+	fpAlloc fpMemoryAlloc;                  // memory allocation function
+	fpErrorContext fpErrorHandlerContext;   // error handler function with context
+	fpAllocContext fpMemoryAllocContext;    // memory allocation function with context
+	void*   context;                        // calling program context for the callbacks
+	string  textOut;                        // formatted text, capacity is kept between calls
+	string  options;                        // the options given to setOptions
+	bool    hasValidOptions;                // setOptions found no errors
+};
+
 #endif	// ASTYLE_LIB
 
 //----------------------------------------------------------------------------
@@ -388,8 +718,8 @@ private:
 // they are called externally and are NOT part of the namespace
 //----------------------------------------------------------------------------
 #ifdef ASTYLE_JNI
-void  STDCALL javaErrorHandler(int errorNumber, const char* errorMessage);
-char* STDCALL javaMemoryAlloc(unsigned long memoryNeeded);
+void  STDCALL javaErrorHandler(void* context, int errorNumber, const char* errorMessage);
+char* STDCALL javaMemoryAlloc(void* context, unsigned long memoryNeeded);
 // the following function names are constructed from method names in the calling java program
 extern "C" EXPORT
 jstring STDCALL Java_AStyleInterface_AStyleGetVersion(JNIEnv* env, jclass);
@@ -422,6 +752,26 @@ extern "C" EXPORT char* STDCALL AStyleMain(const char* pSourceIn,
                                            fpError fpErrorHandler,
                                            fpAlloc fpMemoryAlloc);
 extern "C" EXPORT const char* STDCALL AStyleGetVersion(void);
+extern "C" EXPORT char* STDCALL AStyleMainContext(const char* pSourceIn,
+                                                  const char* pOptions,
+                                                  fpErrorContext fpErrorHandler,
+                                                  fpAllocContext fpMemoryAlloc,
+                                                  void* context);
+
+// the handle is opaque to the calling program
+typedef astyle::ASLibraryFormatter* AStyleHandle;
+extern "C" EXPORT AStyleHandle STDCALL AStyleCreate(const char* pOptions,
+                                                    fpError fpErrorHandler,
+                                                    fpAlloc fpMemoryAlloc);
+extern "C" EXPORT AStyleHandle STDCALL AStyleCreateContext(const char* pOptions,
+                                                           fpErrorContext fpErrorHandler,
+                                                           fpAllocContext fpMemoryAlloc,
+                                                           void* context);
+extern "C" EXPORT char* STDCALL AStyleFormat(AStyleHandle handle,
+                                             const char* pSourceIn,
+                                             unsigned long sourceLength,
+                                             unsigned long* pTextLengthOut);
+extern "C" EXPORT void STDCALL AStyleDestroy(AStyleHandle handle);
 #endif	// ASTYLE_LIB
 
 //-----------------------------------------------------------------------------
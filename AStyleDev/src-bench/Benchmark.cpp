@@ -0,0 +1,415 @@
+// Benchmark.cpp
+
+/* This program measures the Artistic Style formatting throughput.
+ * It formats the astyle source files in a test-data directory and
+ * synthetic files made by joining them, with each of the OPT0 - OPT3
+ * option sets from AStyleTest/file-py/libastyle.py.
+ * The read, format, and write phases are reported separately with the
+ * MB/s, lines/s, memory allocations, allocations per line, and peak
+ * resident set size. The formatter is reused for all of the files, so the
+ * format allocations per line show the steady state cost of each line.
+ * Use --json for machine-readable output to compare releases.
+ */
+
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <sys/resource.h>
+#endif
+
+using namespace std;
+
+// allow for different calling conventions in Linux and Windows
+#ifdef _WIN32
+    #define STDCALL __stdcall
+#else
+    #define STDCALL
+#endif
+
+// functions to call the Artistic Style library
+extern "C" const char* STDCALL AStyleGetVersion(void);
+extern "C" void* STDCALL AStyleCreate(const char* pOptions,
+                                      void (STDCALL* fpError)(int, const char*),
+                                      char* (STDCALL* fpAlloc)(unsigned long));
+extern "C" char* STDCALL AStyleFormat(void* handle,
+                                      const char* pSourceIn,
+                                      unsigned long sourceLength,
+                                      unsigned long* pTextLengthOut);
+extern "C" void STDCALL AStyleDestroy(void* handle);
+void  STDCALL ASErrorHandler(int errorNumber, const char* errorMessage);
+char* STDCALL ASMemoryAlloc(unsigned long memoryNeeded);
+
+// the option sets from libastyle.py
+struct OptionSet
+{
+    const char* name;
+    const char* options;
+};
+
+const OptionSet optionSets[] =
+{
+    { "OPT0", "" },
+    { "OPT1", "-CSKNLwxwxWYM50m0FpPHUEk1yexbjOocxMxQxqxSxP1" },
+    { "OPT2", "-xGSKNLwxWM60m3fpdHUxeEk3W1eJcxMxRxrxsxP0" },
+    { "OPT3", "-xwM80m1DyHUEk2W3xbxjxyxpxkxVxcxlxnxdxgxt2" },
+};
+
+// the test-data files
+const char* const testDataFiles[] = { "ASBeautifier.cpp", "ASFormatter.cpp", "astyle.h" };
+
+// the measurement for one phase
+struct PhaseResult
+{
+    string input;
+    string optionSet;
+    string phase;
+    size_t bytes;               // of the input file for all phases
+    size_t lines;
+    double seconds;             // the fastest of the repeated runs
+    size_t allocations;         // for one run
+    size_t allocationBytes;     // for one run
+    long   peakRssKB;           // after the phase
+};
+
+// the benchmark input files
+struct InputFile
+{
+    string name;
+    string path;
+    bool   isTemporary;
+};
+
+// allocation counters for the global operator new
+atomic<size_t> allocationCount(0);
+atomic<size_t> allocationBytes(0);
+int errorCount = 0;
+
+// other functions
+void error(const string& message);
+long getPeakRssKB();
+size_t countLines(const string& text);
+string readFile(const string& filePath);
+void writeFile(const string& filePath, const char* text, size_t textLength);
+void printJson(const vector<PhaseResult>& results, int repeat);
+void printText(const vector<PhaseResult>& results);
+double allocationsPerLine(const PhaseResult& result);
+string jsonEscape(const string& text);
+
+// Count every allocation made by the formatter and this program.
+void* operator new(size_t size)
+{
+    allocationCount++;
+    allocationBytes += size;
+    void* p = malloc(size ? size : 1);
+    if (p == nullptr)
+        throw bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept
+{
+    allocationCount++;
+    allocationBytes += size;
+    return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const nothrow_t& tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+// Main function for the benchmark.
+// Usage: Benchmark [--json] [--repeat=#] [--scale=#] [--temp=dir] test-data-dir
+int main(int argc, char** argv)
+{   // get the command line options
+    bool useJson = false;
+    int repeat = 5;
+    vector<int> scales;
+    string tempDirectory = ".";
+    string testDataDirectory;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--json")
+            useJson = true;
+        else if (arg.compare(0, 9, "--repeat=") == 0)
+            repeat = atoi(arg.substr(9).c_str());
+        else if (arg.compare(0, 8, "--scale=") == 0)
+            scales.push_back(atoi(arg.substr(8).c_str()));
+        else if (arg.compare(0, 7, "--temp=") == 0)
+            tempDirectory = arg.substr(7);
+        else if (arg[0] == '-')
+            error("Invalid option " + arg);
+        else
+            testDataDirectory = arg;
+    }
+    if (testDataDirectory.empty())
+        error("Usage: Benchmark [--json] [--repeat=#] [--scale=#] [--temp=dir] test-data-dir");
+    if (repeat < 1)
+        repeat = 1;
+    if (scales.empty())
+    {
+        scales.push_back(4);
+        scales.push_back(16);
+    }
+
+    // the test-data files and the synthetic files made by joining them
+    vector<InputFile> inputs;
+    string testDataText;
+    for (const char* fileName : testDataFiles)
+    {
+        string filePath = testDataDirectory + "/" + fileName;
+        testDataText += readFile(filePath);
+        inputs.push_back({ fileName, filePath, false });
+    }
+    for (int scale : scales)
+    {
+        string fileName = "synthetic-x" + to_string(scale) + ".cpp";
+        string filePath = tempDirectory + "/" + fileName;
+        string text;
+        text.reserve(testDataText.length() * scale);
+        for (int i = 0; i < scale; i++)
+            text += testDataText;
+        writeFile(filePath, text.c_str(), text.length());
+        inputs.push_back({ fileName, filePath, true });
+    }
+    string outputPath = tempDirectory + "/benchmark-output.tmp";
+
+    // run the phases for each input and option set
+    vector<PhaseResult> results;
+    for (const OptionSet& optionSet : optionSets)
+    {
+        void* handle = AStyleCreate(optionSet.options, ASErrorHandler, ASMemoryAlloc);
+        if (handle == nullptr)
+            error(string("Cannot create formatter for ") + optionSet.name);
+        for (const InputFile& input : inputs)
+        {
+            string textIn;
+            char* textOut = nullptr;
+            unsigned long textOutLength = 0;
+            for (int phase = 0; phase < 3; phase++)
+            {
+                PhaseResult result;
+                result.input = input.name;
+                result.optionSet = optionSet.name;
+                result.phase = phase == 0 ? "read" : phase == 1 ? "format" : "write";
+                result.seconds = 0;
+                for (int run = 0; run < repeat; run++)
+                {
+                    if (phase == 1)
+                        delete [] textOut;
+                    size_t countStart = allocationCount;
+                    size_t bytesStart = allocationBytes;
+                    auto start = chrono::steady_clock::now();
+                    if (phase == 0)
+                        textIn = readFile(input.path);
+                    else if (phase == 1)
+                        textOut = AStyleFormat(handle, textIn.c_str(), textIn.length(), &textOutLength);
+                    else
+                        writeFile(outputPath, textOut, textOutLength);
+                    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+                    if (run == 0 || elapsed.count() < result.seconds)
+                        result.seconds = elapsed.count();
+                    result.allocations = allocationCount - countStart;
+                    result.allocationBytes = allocationBytes - bytesStart;
+                    if (phase == 1 && textOut == nullptr)
+                        error("Cannot format " + input.name);
+                }
+                result.bytes = textIn.length();
+                result.lines = countLines(textIn);
+                result.peakRssKB = getPeakRssKB();
+                results.push_back(result);
+            }
+            delete [] textOut;
+        }
+        AStyleDestroy(handle);
+    }
+
+    // remove the temporary files
+    remove(outputPath.c_str());
+    for (const InputFile& input : inputs)
+        if (input.isTemporary)
+            remove(input.path.c_str());
+
+    if (useJson)
+        printJson(results, repeat);
+    else
+        printText(results);
+    return errorCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Error handler for the Artistic Style formatter.
+void STDCALL ASErrorHandler(int errorNumber, const char* errorMessage)
+{   cerr << "astyle error " << errorNumber << "\n"
+         << errorMessage << endl;
+    errorCount++;
+}
+
+// Allocate memory for the Artistic Style formatter.
+char* STDCALL ASMemoryAlloc(unsigned long memoryNeeded)
+{   // error condition is checked after return from AStyleFormat
+    char* buffer = new (nothrow) char [memoryNeeded];
+    return buffer;
+}
+
+// Error message function for the benchmark.
+void error(const string& message)
+{   cerr << message << endl;
+    cerr << "The program has terminated!" << endl;
+    exit(EXIT_FAILURE);
+}
+
+// Get the peak resident set size of the process in KB.
+long getPeakRssKB()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+    return static_cast<long>(counters.PeakWorkingSetSize / 1024);
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;      // bytes on macOS
+#else
+    return usage.ru_maxrss;             // KB on Linux
+#endif
+#endif
+}
+
+// Count the lines in the text, including a last line without a line end.
+size_t countLines(const string& text)
+{
+    size_t lines = 0;
+    for (char ch : text)
+        if (ch == '\n')
+            lines++;
+    if (!text.empty() && text.back() != '\n')
+        lines++;
+    return lines;
+}
+
+// Read a file as binary.
+string readFile(const string& filePath)
+{
+    ifstream in(filePath.c_str(), ios::binary);
+    if (!in)
+        error("Cannot open input file " + filePath);
+    in.seekg(0, ios::end);
+    streamoff fileSize = in.tellg();
+    in.seekg(0, ios::beg);
+    string text(static_cast<size_t>(fileSize), '\0');
+    if (fileSize > 0)
+        in.read(&text[0], fileSize);
+    if (!in)
+        error("Cannot read input file " + filePath);
+    return text;
+}
+
+// Write a file as binary.
+void writeFile(const string& filePath, const char* text, size_t textLength)
+{
+    ofstream out(filePath.c_str(), ios::binary);
+    if (!out)
+        error("Cannot open output file " + filePath);
+    out.write(text, static_cast<streamsize>(textLength));
+    out.close();
+    if (!out)
+        error("Cannot write output file " + filePath);
+}
+
+// Print the results as a JSON object.
+void printJson(const vector<PhaseResult>& results, int repeat)
+{
+    cout << "{\n";
+    cout << "  \"version\": \"" << jsonEscape(AStyleGetVersion()) << "\",\n";
+    cout << "  \"repeat\": " << repeat << ",\n";
+    cout << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const PhaseResult& result = results[i];
+        double seconds = result.seconds > 0 ? result.seconds : 1e-9;
+        ostringstream line;
+        line.precision(9);
+        line << fixed
+             << "    { \"input\": \"" << jsonEscape(result.input) << "\""
+             << ", \"options\": \"" << result.optionSet << "\""
+             << ", \"phase\": \"" << result.phase << "\""
+             << ", \"bytes\": " << result.bytes
+             << ", \"lines\": " << result.lines
+             << ", \"seconds\": " << result.seconds
+             << ", \"mb_per_sec\": " << result.bytes / seconds / 1e6
+             << ", \"lines_per_sec\": " << result.lines / seconds
+             << ", \"allocations\": " << result.allocations
+             << ", \"allocations_per_line\": " << allocationsPerLine(result)
+             << ", \"allocation_bytes\": " << result.allocationBytes
+             << ", \"peak_rss_kb\": " << result.peakRssKB
+             << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+        cout << line.str();
+    }
+    cout << "  ]\n";
+    cout << "}" << endl;
+}
+
+// Print the results as a table.
+void printText(const vector<PhaseResult>& results)
+{
+    cout << "Benchmark - AStyle " << AStyleGetVersion() << "\n\n";
+    printf("%-20s %-5s %-7s %10s %12s %10s %11s %12s %10s\n",
+           "input", "opts", "phase", "MB/s", "lines/s", "allocs", "allocs/line", "alloc KB", "peak KB");
+    for (const PhaseResult& result : results)
+    {
+        double seconds = result.seconds > 0 ? result.seconds : 1e-9;
+        printf("%-20s %-5s %-7s %10.1f %12.0f %10zu %11.2f %12zu %10ld\n",
+               result.input.c_str(), result.optionSet.c_str(), result.phase.c_str(),
+               result.bytes / seconds / 1e6, result.lines / seconds,
+               result.allocations, allocationsPerLine(result),
+               result.allocationBytes / 1024, result.peakRssKB);
+    }
+}
+
+// Get the allocations for each input line.
+double allocationsPerLine(const PhaseResult& result)
+{
+    if (result.lines == 0)
+        return 0;
+    return static_cast<double>(result.allocations) / result.lines;
+}
+
+// Escape a string for JSON output.
+string jsonEscape(const string& text)
+{
+    string escaped;
+    for (char ch : text)
+    {
+        if (ch == '"' || ch == '\\')
+            escaped += '\\';
+        escaped += ch;
+    }
+    return escaped;
+}
@@ -3745,6 +3745,49 @@ TEST(IndentPreprocDefine, PreprocessorWithinDefine)
 	delete[] textOut;
 }
 
+TEST(IndentPreprocDefine, NestedConditionals)
+{
+	// Test nested preprocessor conditionals and a define within a conditional.
+	// The beautifiers cloned for the conditionals are reused after an #endif.
+	char text[] =
+	    "\nclass Foo\n"
+	    "{\n"
+	    "public:\n"
+	    "#if defined(A)\n"
+	    "    void bar()\n"
+	    "    {\n"
+	    "        if (isA)\n"
+	    "        {\n"
+	    "#ifdef B\n"
+	    "            foo();\n"
+	    "#elif defined(C)\n"
+	    "            switch (x)\n"
+	    "            {\n"
+	    "            case 1:\n"
+	    "                break;\n"
+	    "            }\n"
+	    "#else\n"
+	    "#define FOO(x) \\\n"
+	    "    if (x) \\\n"
+	    "        foo(x);\n"
+	    "            fooBar();\n"
+	    "#endif\n"
+	    "        }\n"
+	    "    }\n"
+	    "#else\n"
+	    "    void bar();\n"
+	    "#endif\n"
+	    "\n"
+	    "#ifdef D\n"
+	    "    int x;\n"
+	    "#endif\n"
+	    "};";
+	char options[] = "--indent-preproc-define";
+	char* textOut = AStyleMain(text, options, errorHandler, memoryAlloc);
+	EXPECT_STREQ(text, textOut);
+	delete[] textOut;
+}
+
 //-------------------------------------------------------------------------
 // AStyle Indent Preprocessor Conditional
 //-------------------------------------------------------------------------
@@ -3876,7 +3919,7 @@ TEST(IndentPreprocConditional, ExternC2)
 	// Test indent preprocessor conditional around an extern "C" statement.
 	// The closing extern "C" brace is in a #else preprocessor statement.
 	// It will NOT format correctly unless the variable
-	// g_preprocessorCppExternCBrace is global.
+	// preprocessorCppExternCBrace is shared with the active beautifier.
 	char text[] =
 	    "\n#if HAVE_TSEARCH\n"
 	    "#include <search.h>\n"
@@ -3908,7 +3951,7 @@ TEST(IndentPreprocConditional, ExternC2Sans)
 	// Test extern "C" statement WITHOUT indent preprocessor conditional.
 	// The closing extern "C" brace is in a #else preprocessor statement.
 	// It will NOT format correctly unless the variable
-	// g_preprocessorCppExternCBrace is global.
+	// preprocessorCppExternCBrace is shared with the active beautifier.
 	char text[] =
 	    "\n#if HAVE_TSEARCH\n"
 	    "#include <search.h>\n"
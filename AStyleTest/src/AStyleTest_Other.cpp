@@ -6000,6 +6000,105 @@ TEST(Other, MaintainAssignmenPadding)
 	delete[] textOut;
 }
 
+TEST(Other, PeekLongComment)
+{
+	// test peeking past a comment longer than the peek cache
+	// break-blocks should find the header following the comment
+	string textIn =
+	    "void Foo()\n"
+	    "{\n"
+	    "    bar();\n"
+	    "    /* comment\n";
+	for (int i = 0; i < 1200; i++)
+		textIn.append("     * comment line\n");
+	textIn.append(
+	    "     */\n"
+	    "    if (isFoo)\n"
+	    "        bar();\n"
+	    "}\n");
+	string text = textIn;
+	text.insert(text.find("    /*"), "\n");
+	char options[] = "break-blocks";
+	char* textOut = AStyleMain(textIn.c_str(), options, errorHandler, memoryAlloc);
+	EXPECT_STREQ(text.c_str(), textOut);
+	delete[] textOut;
+}
+
+TEST(Other, PeekRepeatedComments)
+{
+	// test peeking the same comment lines from consecutive lines
+	// the comments following each case are peeked for the next header
+	string text =
+	    "void Foo(int x)\n"
+	    "{\n"
+	    "    switch (x)\n"
+	    "    {\n";
+	for (int i = 0; i < 20; i++)
+	{
+		text.append("    case " + to_string(i) + ":\n");
+		for (int j = 0; j < 60; j++)
+			text.append("        // comment line\n");
+		text.append("        bar();\n"
+		            "        break;\n"
+		            "\n");
+	}
+	text.append(
+	    "    default:\n"
+	    "        break;\n"
+	    "    }\n"
+	    "}\n");
+	char options[] = "break-blocks";
+	char* textOut = AStyleMain(text.c_str(), options, errorHandler, memoryAlloc);
+	EXPECT_STREQ(text.c_str(), textOut);
+	delete[] textOut;
+}
+
+TEST(Other, CommentTextAppended)
+{
+	// test the comment text appended at once without max-code-length
+	// the output must be the same as the text appended by characters
+	char text[] =
+	    "\nvoid Foo()\n"
+	    "{\n"
+	    "    /* comment\twith a tab */ bar();\n"
+	    "    /* multi-line\n"
+	    "       comment\twith a tab\n"
+	    "    */\n"
+	    "    int x = 1;  // line comment\twith a tab\n"
+	    "    // line comment only\n"
+	    "    if (isFoo) { bar(); } /* comment */\n"
+	    "    /**/\n"
+	    "    baz(); /* comment */ }\n"
+	    "\n"
+	    "/* comment ending the file */";
+	char text2[] =
+	    "\nvoid Foo()\n"
+	    "{\n"
+	    "    /* comment\twith a tab */ bar();\n"
+	    "    /* multi-line\n"
+	    "       comment\twith a tab\n"
+	    "    */\n"
+	    "    int x = 1;  // line comment\twith a tab\n"
+	    "    // line comment only\n"
+	    "    if (isFoo) {\n"
+	    "        bar();    /* comment */\n"
+	    "    }\n"
+	    "    /**/\n"
+	    "    baz(); /* comment */\n"
+	    "}\n"
+	    "\n"
+	    "/* comment ending the file */";
+	char options[] = "";
+	char* textOut = AStyleMain(text, options, errorHandler, memoryAlloc);
+	EXPECT_STREQ(text2, textOut);
+	delete[] textOut;
+	// max-code-length appends the comments by characters
+	char optionsMax[] = "max-code-length=200";
+	textOut = AStyleMain(text, optionsMax, errorHandler, memoryAlloc);
+	EXPECT_STREQ(text2, textOut);
+	delete[] textOut;
+}
+
 
 //----------------------------------------------------------------------------
 
@@ -82,6 +82,41 @@ TEST(ProcessOptions, ExcludeHitsVector)
 		EXPECT_FALSE(excludeHitsVector[i]);
 }
 
+TEST(ProcessOptions, ExcludeMatcher)
+// test ASExcludeMatcher with the excludes from processOptions
+{
+	ASFormatter formatter;
+	unique_ptr<ASConsole> console(new ASConsole(formatter));
+	vector<string> excludesIn;
+	excludesIn.push_back("--exclude=prog1.cpp");
+	excludesIn.push_back("--exclude=dir1/prog1.cpp");
+	excludesIn.push_back("--exclude=dir2");
+	excludesIn.push_back("--exclude=/dir3/prog3.cpp");
+	excludesIn.push_back("--exclude=dir2");
+	console->processOptions(excludesIn);
+	vector<string> excludeVector = console->getExcludeVector();
+	ASExcludeMatcher excludeMatcher;
+	for (size_t i = 0; i < excludeVector.size(); i++)
+		excludeMatcher.addExclude(excludeVector[i], i);
+	// build paths for checking results
+	vector<string> paths;
+	paths.push_back("/home/user/dir1/prog1.cpp");
+	paths.push_back("/home/user/dir1/xprog1.cpp");
+	paths.push_back("/home/user/dir2");
+	paths.push_back("/home/user/dir2/prog2.cpp");
+	paths.push_back("/home/user/dir3/prog3.cpp");
+	paths.push_back("dir3/prog3.cpp");
+	for (size_t i = 0; i < paths.size(); i++)
+		console->standardizePath(paths[i]);
+	// check the first matching exclude
+	EXPECT_EQ(0U, excludeMatcher.findExclude(paths[0]));
+	EXPECT_EQ(string::npos, excludeMatcher.findExclude(paths[1]));
+	EXPECT_EQ(2U, excludeMatcher.findExclude(paths[2]));
+	EXPECT_EQ(string::npos, excludeMatcher.findExclude(paths[3]));
+	EXPECT_EQ(3U, excludeMatcher.findExclude(paths[4]));
+	EXPECT_EQ(3U, excludeMatcher.findExclude(paths[5]));
+}
+
 TEST(ProcessOptions, FileNameVector)
 // test processOptions for fileNameVector
 {
@@ -1982,7 +2017,7 @@ TEST(OperatorVectorSequence, BuildOperators)
 {
 	// build the operators vector
 	ASResource resource;
-	vector<const string*> operators;
+	ASKeywordList operators;
 	resource.buildOperators(&operators, C_TYPE);
 	// test the operators vector sequence
 	// vector sequence is descending length of the operators
@@ -1999,7 +2034,7 @@ TEST(OperatorVectorSequence, BuildAssignmentOperators)
 {
 	// build the assignmentOperators vector
 	ASResource resource;
-	vector<const string*> assignmentOperators;
+	ASKeywordList assignmentOperators;
 	resource.buildAssignmentOperators(&assignmentOperators);
 	// test the assignmentOperators vector sequence
 	// vector sequence is descending length of the operators
@@ -2016,7 +2051,7 @@ TEST(OperatorVectorSequence, BuildNonAssignmentOperators)
 {
 	// build the nonAssignmentOperators vector
 	ASResource resource;
-	vector<const string*> nonAssignmentOperators;
+	ASKeywordList nonAssignmentOperators;
 	resource.buildNonAssignmentOperators(&nonAssignmentOperators);
 	// test the nonAssignmentOperators vector sequence
 	// vector sequence is descending length of the operators
@@ -2037,7 +2072,7 @@ TEST(HeaderVectorSequence, BuildCastOperators)
 {
 	// build the castOperators vector
 	ASResource resource;
-	vector<const string*> castOperators;
+	ASKeywordList castOperators;
 	resource.buildCastOperators(&castOperators);
 	// test the castOperators vector sequence
 	// vector sequence is ascending header value
@@ -2054,7 +2089,7 @@ TEST(HeaderVectorSequence, BuildHeaders)
 {
 	// build the headers vector
 	ASResource resource;
-	vector<const string*> headers;
+	ASKeywordList headers;
 	resource.buildHeaders(&headers, SHARP_TYPE, true);
 	// test the headers vector sequence
 	// vector sequence is ascending header value
@@ -2071,7 +2106,7 @@ TEST(HeaderVectorSequence, BuildIndentableHeaders)
 {
 	// build the indentableHeaders vector
 	ASResource resource;
-	vector<const string*> indentableHeaders;
+	ASKeywordList indentableHeaders;
 	resource.buildIndentableHeaders(&indentableHeaders);
 	// test the indentableHeaders vector sequence
 	// vector sequence is ascending header value
@@ -2088,7 +2123,7 @@ TEST(HeaderVectorSequence, BuildNonParenHeaders)
 {
 	// build the nonParenHeaders vector
 	ASResource resource;
-	vector<const string*> nonParenHeaders;
+	ASKeywordList nonParenHeaders;
 	resource.buildNonParenHeaders(&nonParenHeaders, SHARP_TYPE, true);
 	// test the nonParenHeaders vector sequence
 	// vector sequence is ascending header value
@@ -2105,7 +2140,7 @@ TEST(HeaderVectorSequence, BuildPreBlockStatements)
 {
 	// build the preBlockStatements vector
 	ASResource resource;
-	vector<const string*> preBlockStatements;
+	ASKeywordList preBlockStatements;
 	resource.buildPreBlockStatements(&preBlockStatements, SHARP_TYPE);
 	// test the preBlockStatements vector sequence
 	// vector sequence is ascending header value
@@ -2122,7 +2157,7 @@ TEST(HeaderVectorSequence, BuildPreCommandHeaders)
 {
 	// build the preCommandHeaders vector
 	ASResource resource;
-	vector<const string*> preCommandHeaders;
+	ASKeywordList preCommandHeaders;
 	resource.buildPreCommandHeaders(&preCommandHeaders, SHARP_TYPE);
 	// test the preCommandHeaders vector sequence
 	// vector sequence is ascending header value
@@ -2139,7 +2174,7 @@ TEST(HeaderVectorSequence, BuildPreDefinitionHeaders)
 {
 	// build the preDefinitionHeaders vector
 	ASResource resource;
-	vector<const string*> preDefinitionHeaders;
+	ASKeywordList preDefinitionHeaders;
 	resource.buildPreDefinitionHeaders(&preDefinitionHeaders, SHARP_TYPE);
 	// test the preDefinitionHeaders vector sequence
 	// vector sequence is ascending header value
@@ -2151,6 +2186,75 @@ TEST(HeaderVectorSequence, BuildPreDefinitionHeaders)
 	}
 }
 
+TEST(HeaderVectorSequence, KeywordListIndex)
+// check that the first character index has the vector sequence
+{
+	// build the vectors
+	ASResource resource;
+	ASKeywordList headers;
+	resource.buildHeaders(&headers, SHARP_TYPE, true);
+	ASKeywordList operators;
+	resource.buildOperators(&operators, C_TYPE);
+	// the index for each character must be the vector entries
+	// beginning with the character in the same sequence
+	const ASKeywordList* keywordLists[] = { &headers, &operators };
+	for (const ASKeywordList* keywordList : keywordLists)
+	{
+		size_t indexed = 0;
+		for (int ch = 0; ch < 256; ch++)
+		{
+			vector<const string*> expected;
+			for (size_t i = 0; i < keywordList->size(); i++)
+				if ((unsigned char) (*(*keywordList)[i])[0] == ch)
+					expected.push_back((*keywordList)[i]);
+			vector<const string*> actual(keywordList->indexBegin((char) ch),
+			                             keywordList->indexEnd((char) ch));
+			EXPECT_EQ(expected, actual);
+			indexed += actual.size();
+		}
+		EXPECT_EQ(keywordList->size(), indexed);
+	}
+}
+
+TEST(HeaderVectorSequence, KeywordListIndexInvalidated)
+// check that a changed keyword list cannot be searched until it is indexed
+{
+	ASKeywordList headers;
+	ASResource::buildHeaders(&headers, C_TYPE);
+	EXPECT_NE(headers.indexBegin('i'), headers.indexEnd('i'));
+	// cannot use death test with leak finder
+#if GTEST_HAS_DEATH_TEST && !(LEAK_DETECTOR || LEAK_FINDER)
+	// the index is invalid after a change to the list
+	headers.emplace_back(&ASResource::AS_IF);
+	EXPECT_DEBUG_DEATH(headers.indexBegin('i'), "isIndexed");
+	headers.buildIndex();
+	headers.sort(sortOnName);
+	EXPECT_DEBUG_DEATH(headers.indexEnd('i'), "isIndexed");
+#endif
+}
+
+TEST(HeaderVectorSequence, KeywordTablesShared)
+// check that the keyword tables are built once for each file type
+{
+	const ASKeywordTables* cTables = ASResource::getKeywordTables(C_TYPE);
+	const ASKeywordTables* javaTables = ASResource::getKeywordTables(JAVA_TYPE);
+	const ASKeywordTables* sharpTables = ASResource::getKeywordTables(SHARP_TYPE);
+	EXPECT_EQ(cTables, ASResource::getKeywordTables(C_TYPE));
+	EXPECT_EQ(javaTables, ASResource::getKeywordTables(JAVA_TYPE));
+	EXPECT_EQ(sharpTables, ASResource::getKeywordTables(SHARP_TYPE));
+	EXPECT_NE(cTables, javaTables);
+	EXPECT_NE(cTables, sharpTables);
+	// the tables must be the same as the individually built vectors
+	ASKeywordList headers;
+	ASResource::buildHeaders(&headers, JAVA_TYPE, true);
+	EXPECT_EQ(vector<const string*>(headers.begin(), headers.end()),
+	          vector<const string*>(javaTables->beautifierHeaders.begin(), javaTables->beautifierHeaders.end()));
+	ASKeywordList operators;
+	ASResource::buildOperators(&operators, SHARP_TYPE);
+	EXPECT_EQ(vector<const string*>(operators.begin(), operators.end()),
+	          vector<const string*>(sharpTables->operators.begin(), sharpTables->operators.end()));
+}
+
 //----------------------------------------------------------------------------
 // AStyle Disable Formatting
 //----------------------------------------------------------------------------
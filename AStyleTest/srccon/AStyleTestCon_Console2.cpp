@@ -17,6 +17,10 @@
 #include "AStyleTestCon.h"
 #ifdef _WIN32
 	#include <windows.h>
+#else
+	#include <dirent.h>
+	#include <sys/resource.h>
+	#include <unistd.h>
 #endif
 
 //----------------------------------------------------------------------------
@@ -904,6 +908,45 @@ TEST_F(RecursiveF, HiddenFiles)
 #endif
 }
 
+#ifndef _WIN32
+TEST_F(RecursiveF, DeepTree)
+// test recursive option with more directory levels than file descriptors
+{
+	console->setIsQuiet(true);		// change this to see results
+	console->setIsRecursive(true);
+	// write the directory tree
+	char textIn[] = "void foo(){}\n";
+	const int levels = 80;
+	string dirOut = getTestDirectory();
+	for (int i = 0; i < levels; i++)
+	{
+		dirOut += "/d";
+		createTestDirectory(dirOut);
+	}
+	string fileOut = dirOut + "/deep.cpp";
+	createTestFile(fileOut, textIn);
+	// cannot use death test with leak finder
+#if GTEST_HAS_DEATH_TEST && !(LEAK_DETECTOR || LEAK_FINDER)
+	// run in a child process with the open files limited to less than the levels
+	EXPECT_EXIT(
+	{
+		struct rlimit openFiles;
+		getrlimit(RLIMIT_NOFILE, &openFiles);
+		openFiles.rlim_cur = 40;
+		setrlimit(RLIMIT_NOFILE, &openFiles);
+		vector<string> astyleOptionsVector;
+		astyleOptionsVector.push_back(getTestDirectory() + "/*.cpp");
+		console->processOptions(astyleOptionsVector);
+		console->processFiles();
+		vector<string> fileName = console->getFileName();
+		bool hasFileOut = find(fileName.begin(), fileName.end(), fileOut) != fileName.end();
+		exit(fileName.size() == fileNames.size() + 1 && hasFileOut ? 0 : 1);
+	},
+	ExitedWithCode(0), "");
+#endif
+}
+#endif
+
 //----------------------------------------------------------------------------
 // AStyle test dry-run option - getFilePaths(), wildcmp(), and fileName vector
 //----------------------------------------------------------------------------
@@ -995,6 +1038,664 @@ TEST_F(DryRunF, DryRunSans)
 	}
 }
 
+//----------------------------------------------------------------------------
+// AStyle test jobs option - parallel formatting of the fileName vector
+//----------------------------------------------------------------------------
+
+struct JobsF : public Test
+{
+	ASFormatter formatter;
+	ASConsole* console;
+	vector<string> fileNames;
+
+	// build fileNames vector and write the output files
+	JobsF()
+	{
+		cleanTestDirectory(getTestDirectory());
+		console = new ASConsole(formatter);
+		string sub1 = getTestDirectory() + "/subdir1";
+		string sub2 = getTestDirectory() + "/subdir2";
+		console->standardizePath(sub1);
+		console->standardizePath(sub2);
+		createTestDirectory(sub1);
+		createTestDirectory(sub2);
+		// create file names, the files are written by createTestFiles()
+		for (int i = 10; i < 30; i++)
+		{
+			string dirName = getTestDirectory();
+			if (i % 3 == 1)
+				dirName = sub1;
+			else if (i % 3 == 2)
+				dirName = sub2;
+			fileNames.push_back(dirName + "/jobs" + to_string(i) + ".cpp");
+			console->standardizePath(fileNames.back());
+		}
+		createTestFiles();
+		// sort file names for comparison
+		sort(fileNames.begin(), fileNames.end());
+	}
+
+	~JobsF()
+	{
+		delete console;
+	}
+
+	// write the test files, even numbered files need formatting
+	void createTestFiles()
+	{
+		char textFormatted[] =
+		    "\nvoid foo()\n"
+		    "{\n"
+		    "bar();\n"
+		    "}\n";
+		char textUnchanged[] =
+		    "\nvoid foo()\n"
+		    "{\n"
+		    "    bar();\n"
+		    "}\n";
+		for (size_t i = 0; i < fileNames.size(); i++)
+		{
+			if (i % 2 == 0)
+				createTestFile(fileNames[i], textFormatted);
+			else
+				createTestFile(fileNames[i], textUnchanged);
+		}
+	}
+
+	// read the formatted files
+	vector<string> readTestFiles()
+	{
+		vector<string> fileText;
+		for (size_t i = 0; i < fileNames.size(); i++)
+		{
+			ifstream fin(fileNames[i].c_str(), ios::binary);
+			stringstream text;
+			text << fin.rdbuf();
+			fileText.push_back(text.str());
+		}
+		return fileText;
+	}
+};
+
+TEST_F(JobsF, JobsOption)
+// test jobs option
+{
+	vector<string> optionsIn;
+	optionsIn.push_back("--jobs=4");
+	console->processOptions(optionsIn);
+	EXPECT_EQ(4, console->getNumJobs());
+}
+
+TEST_F(JobsF, JobsOption_Processors)
+// test jobs option using the number of processors
+{
+	vector<string> optionsIn;
+	optionsIn.push_back("--jobs=0");
+	console->processOptions(optionsIn);
+	EXPECT_TRUE(console->getNumJobs() >= 1);
+}
+
+TEST_F(JobsF, JobsOption_Error)
+// test jobs option with invalid values
+{
+	vector<string> optionsIn;
+	optionsIn.push_back("--jobs=");
+	optionsIn.push_back("--jobs=x4");
+	optionsIn.push_back("--jobs=257");
+	// cannot use death test with leak finder
+#if GTEST_HAS_DEATH_TEST && !(LEAK_DETECTOR || LEAK_FINDER)
+	// test processOptions with invalid jobs values
+	EXPECT_EXIT(console->processOptions(optionsIn),
+	            ExitedWithCode(EXIT_FAILURE),
+	            "Invalid command line options:\n"
+	            "\tjobs=\n"
+	            "\tjobs=x4\n"
+	            "\tjobs=257\n"
+	            "For help on options type 'astyle -h'");
+#endif
+}
+
+TEST_F(JobsF, SameAsSerial)
+// test that formatting with jobs has the same result as a serial run
+{
+	vector<string> astyleOptionsVector;
+	astyleOptionsVector.push_back("--recursive");
+	astyleOptionsVector.push_back("--suffix=none");
+	astyleOptionsVector.push_back(getTestDirectory() + "/*.cpp");
+	// serial run
+	console->setIsQuiet(true);		// change this to see results
+	console->processOptions(astyleOptionsVector);
+	console->processFiles();
+	vector<string> serialFileName = console->getFileName();
+	vector<string> serialText = readTestFiles();
+	int serialFormatted = console->getFilesFormatted();
+	int serialLinesOut = console->getLinesOut();
+	// parallel run with a new console
+	createTestFiles();
+	ASFormatter formatterJobs;
+	unique_ptr<ASConsole> consoleJobs(new ASConsole(formatterJobs));
+	astyleOptionsVector.push_back("--jobs=4");
+	consoleJobs->setIsQuiet(true);	// change this to see results
+	consoleJobs->processOptions(astyleOptionsVector);
+	consoleJobs->processFiles();
+	vector<string> jobsFileName = consoleJobs->getFileName();
+	vector<string> jobsText = readTestFiles();
+	// check the results
+	ASSERT_EQ(fileNames.size(), jobsFileName.size());
+	EXPECT_EQ(serialFileName, jobsFileName);
+	EXPECT_EQ(serialText, jobsText);
+	EXPECT_EQ(serialFormatted, consoleJobs->getFilesFormatted());
+	EXPECT_EQ(serialLinesOut, consoleJobs->getLinesOut());
+	EXPECT_EQ((int) fileNames.size() / 2, consoleJobs->getFilesFormatted());
+}
+
+TEST_F(JobsF, Exclude)
+// test jobs option with exclude
+{
+	console->setIsQuiet(true);		// change this to see results
+	vector<string> astyleOptionsVector;
+	astyleOptionsVector.push_back("--recursive");
+	astyleOptionsVector.push_back("--jobs=4");
+	astyleOptionsVector.push_back("--exclude=subdir1");
+	astyleOptionsVector.push_back("--exclude=jobs11.cpp");
+	astyleOptionsVector.push_back(getTestDirectory() + "/*.cpp");
+	console->processOptions(astyleOptionsVector);
+	console->processFiles();
+	// verify excludes
+	vector<bool> excludeHits = console->getExcludeHitsVector();
+	ASSERT_EQ(2U, excludeHits.size());
+	EXPECT_TRUE(excludeHits[0]);
+	EXPECT_TRUE(excludeHits[1]);
+	vector<string> fileName = console->getFileName();
+	EXPECT_EQ(fileNames.size() - 8, fileName.size());
+}
+
+TEST_F(JobsF, ExcludeErrors)
+// test jobs option with an unmatched exclude and ignore-exclude-errors
+// the files are formatted while the directories are being read
+{
+	console->setIsQuiet(true);		// change this to see results
+	vector<string> astyleOptionsVector;
+	astyleOptionsVector.push_back("--recursive");
+	astyleOptionsVector.push_back("--jobs=4");
+	astyleOptionsVector.push_back("--ignore-exclude-errors");
+	astyleOptionsVector.push_back("--exclude=subdir2");
+	astyleOptionsVector.push_back("--exclude=noExcludedFile.cpp");
+	astyleOptionsVector.push_back(getTestDirectory() + "/*.cpp");
+	console->processOptions(astyleOptionsVector);
+	console->processFiles();
+	// verify excludes
+	vector<bool> excludeHits = console->getExcludeHitsVector();
+	ASSERT_EQ(2U, excludeHits.size());
+	EXPECT_TRUE(excludeHits[0]);
+	EXPECT_FALSE(excludeHits[1]);
+	// the files in subdir2 are excluded
+	string sub2 = getTestDirectory() + "/subdir2";
+	console->standardizePath(sub2);
+	vector<string> fileNamesSans;
+	for (size_t i = 0; i < fileNames.size(); i++)
+		if (fileNames[i].compare(0, sub2.length(), sub2) != 0)
+			fileNamesSans.push_back(fileNames[i]);
+	vector<string> fileName = console->getFileName();
+	EXPECT_EQ(fileNamesSans, fileName);
+}
+
+TEST_F(JobsF, WorkerError)
+// test jobs option with an error in a worker thread
+// the error is displayed by the main thread after the workers end
+{
+	// the backup file cannot be removed if it is a directory with a file
+	string backupDir = fileNames[0] + ".orig";
+	createTestDirectory(backupDir);
+	createTestFile(backupDir + "/backup.cpp", "");
+	console->setIsQuiet(true);		// change this to see results
+	vector<string> astyleOptionsVector;
+	astyleOptionsVector.push_back("--recursive");
+	astyleOptionsVector.push_back("--jobs=4");
+	astyleOptionsVector.push_back(getTestDirectory() + "/*.cpp");
+	console->processOptions(astyleOptionsVector);
+	// cannot use death test with leak finder
+#if GTEST_HAS_DEATH_TEST && !(LEAK_DETECTOR || LEAK_FINDER)
+	EXPECT_EXIT(console->processFiles(),
+	            ExitedWithCode(EXIT_FAILURE),
+	            "Cannot remove pre-existing backup file .*\\.orig\n"
+	            "Artistic Style has terminated");
+#endif
+}
+
+#ifndef _WIN32
+
+TEST_F(JobsF, ScanError)
+// test jobs option with an error while the directories are being read
+// the workers end before the error is displayed
+{
+	// a symbolic link to a missing file cannot be checked by stat
+	string badLink = getTestDirectory() + "/subdir2/zzbadlink.cpp";
+	ASSERT_EQ(0, symlink("missing.cpp", badLink.c_str()));
+	console->setIsQuiet(true);		// change this to see results
+	vector<string> astyleOptionsVector;
+	astyleOptionsVector.push_back("--recursive");
+	astyleOptionsVector.push_back("--jobs=4");
+	astyleOptionsVector.push_back(getTestDirectory() + "/*.cpp");
+	console->processOptions(astyleOptionsVector);
+	// cannot use death test with leak finder
+#if GTEST_HAS_DEATH_TEST && !(LEAK_DETECTOR || LEAK_FINDER)
+	EXPECT_EXIT(console->processFiles(),
+	            ExitedWithCode(EXIT_FAILURE),
+	            "Error getting file status in directory .*subdir2\n"
+	            "Artistic Style has terminated");
+#endif
+	// the test directory cannot be cleaned with the link
+	unlink(badLink.c_str());
+}
+
+#endif	// _WIN32
+
+//----------------------------------------------------------------------------
+// AStyle cache option
+//----------------------------------------------------------------------------
+
+struct CacheF : public JobsF
+{
+	string cacheFileName;
+
+	// the cache file is in the directory of the project option file
+	CacheF()
+	{
+		string projectFileName = getTestDirectory() + "/.astylerc";
+		console->standardizePath(projectFileName);
+		createTestFile(projectFileName, "");
+		cacheFileName = getTestDirectory() + "/.astyle-cache";
+		console->standardizePath(cacheFileName);
+	}
+
+	// format the test files with a new console
+	// return the number of lines and the number of files formatted
+	int formatTestFiles(const string& extraOption, int& filesFormatted)
+	{
+		ASFormatter cacheFormatter;
+		ASConsole cacheConsole(cacheFormatter);
+		cacheConsole.setIsQuiet(true);		// change this to see results
+		vector<string> astyleOptionsVector;
+		astyleOptionsVector.push_back("--recursive");
+		astyleOptionsVector.push_back("--suffix=none");
+		astyleOptionsVector.push_back("--cache");
+		astyleOptionsVector.push_back("--project");
+		if (!extraOption.empty())
+			astyleOptionsVector.push_back(extraOption);
+		astyleOptionsVector.push_back(getTestDirectory() + "/*.cpp");
+		cacheConsole.processOptions(astyleOptionsVector);
+		cacheConsole.processFiles();
+		filesFormatted = cacheConsole.getFilesFormatted();
+		return cacheConsole.getLinesOut();
+	}
+
+	// replace the number of lines in the cache entries
+	// used to verify that the cache entries are used
+	void setCacheLines(int lines)
+	{
+		ifstream fin(cacheFileName.c_str(), ios::binary);
+		string line;
+		string text;
+		getline(fin, line);
+		text = line + '\n';
+		while (getline(fin, line))
+		{
+			size_t linesEnd = line.find(' ', 17);
+			ASSERT_NE(string::npos, linesEnd);
+			text += line.substr(0, 17) + to_string(lines) + line.substr(linesEnd) + '\n';
+		}
+		fin.close();
+		ofstream fout(cacheFileName.c_str(), ios::binary | ios::trunc);
+		fout << text;
+	}
+};
+
+TEST_F(CacheF, CacheOption)
+// test cache option
+{
+	vector<string> optionsIn;
+	optionsIn.push_back("--cache");
+	console->processOptions(optionsIn);
+	EXPECT_TRUE(console->getUseCache());
+}
+
+TEST_F(CacheF, UnchangedFilesSkipped)
+// test that unchanged files are saved in the cache and skipped
+{
+	int filesFormatted = 0;
+	int linesOut = formatTestFiles("", filesFormatted);
+	EXPECT_EQ(10, filesFormatted);
+	EXPECT_EQ(120, linesOut);
+	ASSERT_TRUE(console->fileExists(cacheFileName.c_str()));
+	// the formatted files are saved on the second run
+	linesOut = formatTestFiles("", filesFormatted);
+	EXPECT_EQ(0, filesFormatted);
+	EXPECT_EQ(120, linesOut);
+	// the line count is from the cache if the files are skipped
+	setCacheLines(1);
+	linesOut = formatTestFiles("", filesFormatted);
+	EXPECT_EQ(0, filesFormatted);
+	EXPECT_EQ(20, linesOut);
+}
+
+TEST_F(CacheF, ChangedFilesFormatted)
+// test that files changed since the last run are formatted
+{
+	int filesFormatted = 0;
+	formatTestFiles("", filesFormatted);
+	formatTestFiles("", filesFormatted);
+	EXPECT_EQ(0, filesFormatted);
+	// rewrite the files, even numbered files need formatting
+	createTestFiles();
+	int linesOut = formatTestFiles("", filesFormatted);
+	EXPECT_EQ(10, filesFormatted);
+	EXPECT_EQ(120, linesOut);
+}
+
+TEST_F(CacheF, ChangedOptions)
+// test that the cache is cleared when the options change
+{
+	int filesFormatted = 0;
+	formatTestFiles("", filesFormatted);
+	formatTestFiles("", filesFormatted);
+	setCacheLines(1);
+	int linesOut = formatTestFiles("--indent=spaces=4", filesFormatted);
+	EXPECT_EQ(0, filesFormatted);
+	EXPECT_EQ(120, linesOut);
+}
+
+TEST_F(CacheF, ConsoleOptions)
+// test that the cache is kept when only the console options change
+{
+	int filesFormatted = 0;
+	formatTestFiles("", filesFormatted);
+	formatTestFiles("", filesFormatted);
+	setCacheLines(1);
+	int linesOut = formatTestFiles("--jobs=2", filesFormatted);
+	EXPECT_EQ(0, filesFormatted);
+	EXPECT_EQ(20, linesOut);
+	linesOut = formatTestFiles("-qZ", filesFormatted);
+	EXPECT_EQ(0, filesFormatted);
+	EXPECT_EQ(20, linesOut);
+}
+
+TEST_F(CacheF, ReplaceCacheFile)
+// test that the cache file is replaced and the temporary file is removed
+{
+	int filesFormatted = 0;
+	formatTestFiles("", filesFormatted);
+	ASSERT_TRUE(console->fileExists(cacheFileName.c_str()));
+	// a temporary file without the process id is not used
+	string oldTempFileName = cacheFileName + ".tmp";
+	createTestFile(oldTempFileName, "old");
+	formatTestFiles("--indent=spaces=2", filesFormatted);
+	EXPECT_TRUE(console->fileExists(cacheFileName.c_str()));
+	EXPECT_TRUE(console->fileExists(oldTempFileName.c_str()));
+#ifdef _WIN32
+	string tempFileName = cacheFileName + "-" + to_string(GetCurrentProcessId()) + ".tmp";
+#else
+	string tempFileName = cacheFileName + "-" + to_string(getpid()) + ".tmp";
+#endif
+	EXPECT_FALSE(console->fileExists(tempFileName.c_str()));
+}
+
+TEST_F(CacheF, Jobs)
+// test the cache with the jobs option
+{
+	int filesFormatted = 0;
+	int linesOut = formatTestFiles("--jobs=4", filesFormatted);
+	EXPECT_EQ(10, filesFormatted);
+	EXPECT_EQ(120, linesOut);
+	formatTestFiles("--jobs=4", filesFormatted);
+	setCacheLines(1);
+	linesOut = formatTestFiles("--jobs=4", filesFormatted);
+	EXPECT_EQ(0, filesFormatted);
+	EXPECT_EQ(20, linesOut);
+}
+
+//----------------------------------------------------------------------------
+// AStyle writeFile() replacing the original file and no-fsync option
+//----------------------------------------------------------------------------
+
+struct WriteFileF : public JobsF
+{
+	// format the test files with a new console
+	void formatTestFiles(const string& extraOption, const string& extraOption2 = string())
+	{
+		ASFormatter writeFormatter;
+		ASConsole writeConsole(writeFormatter);
+		writeConsole.setIsQuiet(true);		// change this to see results
+		vector<string> astyleOptionsVector;
+		astyleOptionsVector.push_back("--recursive");
+		if (!extraOption.empty())
+			astyleOptionsVector.push_back(extraOption);
+		if (!extraOption2.empty())
+			astyleOptionsVector.push_back(extraOption2);
+		astyleOptionsVector.push_back(getTestDirectory() + "/*.cpp");
+		writeConsole.processOptions(astyleOptionsVector);
+		writeConsole.processFiles();
+	}
+
+	// read a test file
+	string readTestFile(const string& path)
+	{
+		ifstream fin(path.c_str(), ios::binary);
+		stringstream text;
+		text << fin.rdbuf();
+		return text.str();
+	}
+
+	// check for a temporary file written for a file
+	bool hasTempFile(const string& path)
+	{
+		size_t separator = path.find_last_of("/\\");
+		string directory = path.substr(0, separator);
+		string tempPrefix = path.substr(separator + 1) + ".astyle-";
+		bool hasTemp = false;
+#ifdef _WIN32
+		WIN32_FIND_DATA findFileData;
+		HANDLE hFind = FindFirstFile((directory + "\\*").c_str(), &findFileData);
+		if (hFind == INVALID_HANDLE_VALUE)
+			return false;
+		do
+		{
+			if (string(findFileData.cFileName).compare(0, tempPrefix.length(), tempPrefix) == 0)
+				hasTemp = true;
+		}
+		while (FindNextFile(hFind, &findFileData) != 0);
+		FindClose(hFind);
+#else
+		DIR* dp = opendir(directory.c_str());
+		if (dp == nullptr)
+			return false;
+		struct dirent* entry;
+		while ((entry = readdir(dp)) != nullptr)
+		{
+			if (string(entry->d_name).compare(0, tempPrefix.length(), tempPrefix) == 0)
+				hasTemp = true;
+		}
+		closedir(dp);
+#endif
+		return hasTemp;
+	}
+};
+
+TEST_F(WriteFileF, NoFsyncOption)
+// test no-fsync option
+{
+	vector<string> optionsIn;
+	optionsIn.push_back("--no-fsync");
+	console->processOptions(optionsIn);
+	EXPECT_TRUE(console->getNoFsync());
+}
+
+TEST_F(WriteFileF, ReplaceWithBackup)
+// test that the formatted files replace the original files
+// and the original files are the backup files
+{
+	string textIn =
+	    "\nvoid foo()\n"
+	    "{\n"
+	    "bar();\n"
+	    "}\n";
+	string textOut =
+	    "\nvoid foo()\n"
+	    "{\n"
+	    "    bar();\n"
+	    "}\n";
+	formatTestFiles("");
+	for (size_t i = 0; i < fileNames.size(); i++)
+	{
+		string origFileName = fileNames[i] + ".orig";
+		EXPECT_EQ(textOut, readTestFile(fileNames[i]));
+		EXPECT_FALSE(hasTempFile(fileNames[i]));
+		// only the formatted files have a backup
+		if (i % 2 == 0)
+			EXPECT_EQ(textIn, readTestFile(origFileName));
+		else
+			EXPECT_FALSE(console->fileExists(origFileName.c_str()));
+	}
+}
+
+TEST_F(WriteFileF, ReplaceNoFsync)
+// test that the formatted files replace the original files with no-fsync
+{
+	string textOut =
+	    "\nvoid foo()\n"
+	    "{\n"
+	    "    bar();\n"
+	    "}\n";
+	formatTestFiles("--no-fsync");
+	for (size_t i = 0; i < fileNames.size(); i++)
+	{
+		EXPECT_EQ(textOut, readTestFile(fileNames[i]));
+		EXPECT_FALSE(hasTempFile(fileNames[i]));
+	}
+}
+
+#ifndef _WIN32
+
+TEST_F(WriteFileF, KeepPermissions)
+// test that the backup is the original file
+// and the formatted file has the permissions of the original file
+{
+	// fileNames[0] needs formatting
+	ASSERT_EQ(0, chmod(fileNames[0].c_str(), 0600));
+	struct stat origBuf;
+	ASSERT_EQ(0, stat(fileNames[0].c_str(), &origBuf));
+	formatTestFiles("");
+	struct stat backupBuf;
+	ASSERT_EQ(0, stat((fileNames[0] + ".orig").c_str(), &backupBuf));
+	EXPECT_EQ(origBuf.st_ino, backupBuf.st_ino);
+	struct stat outBuf;
+	ASSERT_EQ(0, stat(fileNames[0].c_str(), &outBuf));
+	EXPECT_NE(origBuf.st_ino, outBuf.st_ino);
+	EXPECT_EQ(0600u, outBuf.st_mode & 0777u);
+}
+
+TEST_F(WriteFileF, HardLinkInPlace)
+// test that a file with a hard link is written in place
+// and the backup is a copy of the original file
+{
+	// fileNames[0] needs formatting
+	string textIn = readTestFile(fileNames[0]);
+	string hardLink = getTestDirectory() + "/hardlink.txt";
+	ASSERT_EQ(0, link(fileNames[0].c_str(), hardLink.c_str()));
+	struct stat origBuf;
+	ASSERT_EQ(0, stat(fileNames[0].c_str(), &origBuf));
+	formatTestFiles("");
+	struct stat outBuf;
+	ASSERT_EQ(0, stat(fileNames[0].c_str(), &outBuf));
+	EXPECT_EQ(origBuf.st_ino, outBuf.st_ino);
+	EXPECT_EQ(2u, outBuf.st_nlink);
+	EXPECT_EQ(readTestFile(fileNames[0]), readTestFile(hardLink));
+	EXPECT_NE(textIn, readTestFile(hardLink));
+	EXPECT_EQ(textIn, readTestFile(fileNames[0] + ".orig"));
+	EXPECT_FALSE(hasTempFile(fileNames[0]));
+}
+
+TEST_F(WriteFileF, SuffixNoneReplaced)
+// test that a file without a backup is replaced by the temporary file
+{
+	// fileNames[0] needs formatting
+	string textIn = readTestFile(fileNames[0]);
+	ASSERT_EQ(0, chmod(fileNames[0].c_str(), 0600));
+	struct stat origBuf;
+	ASSERT_EQ(0, stat(fileNames[0].c_str(), &origBuf));
+	formatTestFiles("--suffix=none");
+	struct stat outBuf;
+	ASSERT_EQ(0, stat(fileNames[0].c_str(), &outBuf));
+	EXPECT_NE(origBuf.st_ino, outBuf.st_ino);
+	EXPECT_EQ(0600u, outBuf.st_mode & 0777u);
+	EXPECT_NE(textIn, readTestFile(fileNames[0]));
+	EXPECT_FALSE(console->fileExists((fileNames[0] + ".orig").c_str()));
+	EXPECT_FALSE(hasTempFile(fileNames[0]));
+}
+
+TEST_F(WriteFileF, SymbolicLinkKept)
+// test that a symbolic link is kept and the file it links to is replaced
+{
+	string textIn =
+	    "\nvoid foo()\n"
+	    "{\n"
+	    "bar();\n"
+	    "}\n";
+	string textOut =
+	    "\nvoid foo()\n"
+	    "{\n"
+	    "    bar();\n"
+	    "}\n";
+	string target = getTestDirectory() + "/symtarget.txt";
+	createTestFile(target, textIn.c_str());
+	string symLink = getTestDirectory() + "/symlink.cpp";
+	ASSERT_EQ(0, symlink("symtarget.txt", symLink.c_str()));
+	formatTestFiles("");
+	struct stat linkBuf;
+	ASSERT_EQ(0, lstat(symLink.c_str(), &linkBuf));
+	EXPECT_TRUE(S_ISLNK(linkBuf.st_mode));
+	EXPECT_EQ(textOut, readTestFile(target));
+	EXPECT_EQ(textIn, readTestFile(symLink + ".orig"));
+	EXPECT_FALSE(hasTempFile(target));
+	// the test directory cannot be cleaned with the links
+	unlink(symLink.c_str());
+}
+
+TEST_F(WriteFileF, SymbolicLinksJobs)
+// test --jobs with two symbolic links to the same file
+// each worker must write its own temporary file
+{
+	string textIn =
+	    "\nvoid foo()\n"
+	    "{\n"
+	    "bar();\n"
+	    "}\n";
+	string textOut =
+	    "\nvoid foo()\n"
+	    "{\n"
+	    "    bar();\n"
+	    "}\n";
+	string target = getTestDirectory() + "/symtarget.txt";
+	createTestFile(target, textIn.c_str());
+	string symLink1 = getTestDirectory() + "/symlink1.cpp";
+	string symLink2 = getTestDirectory() + "/symlink2.cpp";
+	ASSERT_EQ(0, symlink("symtarget.txt", symLink1.c_str()));
+	ASSERT_EQ(0, symlink("symtarget.txt", symLink2.c_str()));
+	formatTestFiles("--jobs=4", "--suffix=none");
+	struct stat linkBuf;
+	ASSERT_EQ(0, lstat(symLink1.c_str(), &linkBuf));
+	EXPECT_TRUE(S_ISLNK(linkBuf.st_mode));
+	ASSERT_EQ(0, lstat(symLink2.c_str(), &linkBuf));
+	EXPECT_TRUE(S_ISLNK(linkBuf.st_mode));
+	EXPECT_EQ(textOut, readTestFile(target));
+	EXPECT_FALSE(hasTempFile(target));
+	// the test directory cannot be cleaned with the links
+	unlink(symLink1.c_str());
+	unlink(symLink2.c_str());
+}
+
+#endif	// _WIN32
+
 //----------------------------------------------------------------------------
 // AStyle line ends formatted
 // tests if a line end change formats the file
@@ -1357,7 +2058,7 @@ TEST_F(LineEndsDefaultF, LineEndMacOld)
 
 //----------------------------------------------------------------------------
 // AStyle line ends format
-// tests if default line ends calls the convertLineEnds() function when needed
+// tests that default line ends corrects mixed line ends when needed
 //----------------------------------------------------------------------------
 
 struct LineEndsDefaultMixedF : public Test
@@ -1420,10 +2121,19 @@ struct LineEndsDefaultMixedF : public Test
 	{
 		delete console;
 	}
+
+	// read a formatted file
+	string readTestFile(const string& path)
+	{
+		ifstream fin(path.c_str(), ios::binary);
+		stringstream text;
+		text << fin.rdbuf();
+		return text.str();
+	}
 };
 
 TEST_F(LineEndsDefaultMixedF, LineEndWindows)
-// test if default line ends outputs windows line ends by calling convertLineEnds()
+// test if default line ends outputs windows line ends by correcting mixed line ends
 {
 	console->setIsQuiet(true);		// change this to see results
 	// call astyle processOptions()
@@ -1438,14 +2148,13 @@ TEST_F(LineEndsDefaultMixedF, LineEndWindows)
 	// display error if file is not present
 	if (stat(origFileName.c_str(), &stBuf) == -1)
 		EXPECT_STREQ("no .orig file", origFileName.c_str());
-	// check that convertLineEnds is called
+	// check that the mixed line ends are corrected
 	EXPECT_TRUE(console->getLineEndsMixed());
-	// the line ends must be checked manually
-//	systemPause("Check Windows Line Ends");
+	EXPECT_EQ("\r\nvoid foo()\r\n{\r\n    bar1()\r\n    bar2()\r\n}\r\n", readTestFile(pathWindows));
 }
 
 TEST_F(LineEndsDefaultMixedF, LineEndLinux)
-// test if default line ends outputs linux line ends by calling convertLineEnds()
+// test if default line ends outputs linux line ends by correcting mixed line ends
 {
 	console->setIsQuiet(true);		// change this to see results
 	// call astyle processOptions()
@@ -1460,14 +2169,13 @@ TEST_F(LineEndsDefaultMixedF, LineEndLinux)
 	// display error if file is not present
 	if (stat(origFileName.c_str(), &stBuf) == -1)
 		EXPECT_STREQ("no .orig file", origFileName.c_str());
-	// check that convertLineEnds is called
+	// check that the mixed line ends are corrected
 	EXPECT_TRUE(console->getLineEndsMixed());
-	// the line ends must be checked manually
-//	systemPause("Check Linux Line Ends");
+	EXPECT_EQ("\nvoid foo()\n{\n    bar1()\n    bar2()\n}\n", readTestFile(pathLinux));
 }
 
 TEST_F(LineEndsDefaultMixedF, LineEndMacOld)
-// test if default line ends outputs linux line ends by calling convertLineEnds()
+// test if default line ends outputs macold line ends by correcting mixed line ends
 {
 	console->setIsQuiet(true);		// change this to see results
 	// call astyle processOptions()
@@ -1482,15 +2190,14 @@ TEST_F(LineEndsDefaultMixedF, LineEndMacOld)
 	// display error if file is not present
 	if (stat(origFileName.c_str(), &stBuf) == -1)
 		EXPECT_STREQ("no .orig file", origFileName.c_str());
-	// check that convertLineEnds is called
+	// check that the mixed line ends are corrected
 	EXPECT_TRUE(console->getLineEndsMixed());
-	// the line ends must be checked manually
-//	systemPause("Check MacOld Line Ends");
+	EXPECT_EQ("\rvoid foo()\r{\r    bar1()\r    bar2()\r}\r", readTestFile(pathMacOld));
 }
 
 //----------------------------------------------------------------------------
 // AStyle line ends formatted
-// tests that default line ends does NOT call the convertLineEnds() function when not needed
+// tests that default line ends does NOT find mixed line ends when there are none
 //----------------------------------------------------------------------------
 
 struct LineEndsDefaultMixedSansF : public Test
@@ -1553,7 +2260,7 @@ struct LineEndsDefaultMixedSansF : public Test
 };
 
 TEST_F(LineEndsDefaultMixedSansF, LineEndWindows)
-// test if default line ends outputs windows line ends without calling convertLineEnds()
+// test if default line ends outputs windows line ends without correcting line ends
 {
 	console->setIsQuiet(true);		// change this to see results
 	// call astyle processOptions()
@@ -1568,14 +2275,14 @@ TEST_F(LineEndsDefaultMixedSansF, LineEndWindows)
 	// display error if file is not present
 	if (stat(origFileName.c_str(), &stBuf) == -1)
 		EXPECT_STREQ("no .orig file", origFileName.c_str());
-	// check that convertLineEnds is NOT called
+	// check that the line ends are not mixed
 	EXPECT_FALSE(console->getLineEndsMixed());
 	// the line ends must be checked manually
 //	systemPause("Check Windows Line Ends");
 }
 
 TEST_F(LineEndsDefaultMixedSansF, LineEndLinux)
-// test if default line ends outputs linux line ends without calling convertLineEnds()
+// test if default line ends outputs linux line ends without correcting line ends
 {
 	console->setIsQuiet(true);		// change this to see results
 	// call astyle processOptions()
@@ -1590,14 +2297,14 @@ TEST_F(LineEndsDefaultMixedSansF, LineEndLinux)
 	// display error if file is not present
 	if (stat(origFileName.c_str(), &stBuf) == -1)
 		EXPECT_STREQ("no .orig file", origFileName.c_str());
-	// check that convertLineEnds is NOT called
+	// check that the line ends are not mixed
 	EXPECT_FALSE(console->getLineEndsMixed());
 	// the line ends must be checked manually
 //	systemPause("Check Linux Line Ends");
 }
 
 TEST_F(LineEndsDefaultMixedSansF, LineEndMacOld)
-// test if default line ends outputs linux line ends without calling convertLineEnds()
+// test if default line ends outputs linux line ends without correcting line ends
 {
 	console->setIsQuiet(true);		// change this to see results
 	// call astyle processOptions()
@@ -1612,7 +2319,7 @@ TEST_F(LineEndsDefaultMixedSansF, LineEndMacOld)
 	// display error if file is not present
 	if (stat(origFileName.c_str(), &stBuf) == -1)
 		EXPECT_STREQ("no .orig file", origFileName.c_str());
-	// check that convertLineEnds is NOT called
+	// check that the line ends are not mixed
 	EXPECT_FALSE(console->getLineEndsMixed());
 	// the line ends must be checked manually
 //	systemPause("Check MacOld Line Ends");
@@ -15,10 +15,14 @@
 
 //#include <algorithm>
 #include "AStyleTestCon.h"
+#include <thread>
 #ifdef _WIN32
 	#include <windows.h>
+	#include <fcntl.h>
+	#include <io.h>
 #else
 	#include <fcntl.h>
+	#include <unistd.h>
 #endif
 
 //----------------------------------------------------------------------------
@@ -425,6 +429,320 @@ TEST_F(ProcessMiscOptions3F, HtmlOption_InvalidFileName)
 #endif
 }
 
+//----------------------------------------------------------------------------
+// AStyle ASBufferIterator tests
+// the results must be the same as ASStreamIterator<stringstream>
+//----------------------------------------------------------------------------
+
+template<typename T>
+vector<string> getIteratorTrace(T& iter)
+// read all lines, with peeks, and return a trace of the results
+{
+	vector<string> trace;
+	while (iter.hasMoreLines())
+	{
+		// peek the next two lines
+		for (int i = 0; i < 2 && iter.hasMoreLines(); i++)
+		{
+			trace.push_back("peek " + iter.peekNextLine());
+			trace.push_back("tellg " + to_string(iter.tellg()));
+			trace.push_back("more " + to_string(iter.hasMoreLines()));
+		}
+		if (iter.getPeekStart() != 0)
+			iter.peekReset();
+		trace.push_back("line " + iter.nextLine(false));
+		trace.push_back("eol " + iter.getOutputEOL());
+		trace.push_back("tellg " + to_string(iter.tellg()));
+	}
+	iter.saveLastInputLine();
+	for (int lineEnd = LINEEND_DEFAULT; lineEnd <= LINEEND_MACOLD; lineEnd++)
+		trace.push_back("change " + to_string(iter.getLineEndChange(lineEnd)));
+	trace.push_back("length " + to_string(iter.getStreamLength()));
+	return trace;
+}
+
+TEST(BufferIterator, SameAsStreamIterator)
+// test that ASBufferIterator has the same results as ASStreamIterator
+{
+	vector<string> textIn;
+	textIn.push_back("");
+	textIn.push_back("a");
+	textIn.push_back("a\n");
+	textIn.push_back("a\nb");
+	textIn.push_back("\n\n\n");
+	textIn.push_back("a\r\nb\r\n");
+	textIn.push_back("a\r\nb\r\nc");
+	textIn.push_back("a\rb\r");
+	textIn.push_back("a\rb\rc");
+	textIn.push_back("a\n\rb\n\r");
+	textIn.push_back("a\r\nb\nc\rd\n\re");
+	textIn.push_back("\r\r\n\n\r\n");
+	textIn.push_back("\nvoid foo()\r{\r\n    bar();\n}\r");
+	for (size_t i = 0; i < textIn.size(); i++)
+	{
+		stringstream in(textIn[i]);
+		ASStreamIterator<stringstream> streamIterator(&in);
+		vector<string> streamTrace = getIteratorTrace(streamIterator);
+		ASBufferIterator bufferIterator(textIn[i].data(), textIn[i].length());
+		vector<string> bufferTrace = getIteratorTrace(bufferIterator);
+		EXPECT_EQ(streamTrace, bufferTrace) << "text number " << i;
+	}
+}
+
+TEST(BufferIterator, CompareToInputBuffer)
+// test the previous line compare used to find unchanged files
+{
+	string text = "line1\nline2\n";
+	ASBufferIterator bufferIterator(text.data(), text.length());
+	EXPECT_EQ("line1", bufferIterator.nextLine(false));
+	EXPECT_EQ("line2", bufferIterator.nextLine(false));
+	EXPECT_TRUE(bufferIterator.compareToInputBuffer("line1"));
+	EXPECT_EQ("", bufferIterator.nextLine(false));
+	EXPECT_TRUE(bufferIterator.compareToInputBuffer("line2"));
+	EXPECT_FALSE(bufferIterator.hasMoreLines());
+	bufferIterator.saveLastInputLine();
+	EXPECT_TRUE(bufferIterator.compareToInputBuffer(""));
+}
+
+//----------------------------------------------------------------------------
+// AStyle ASSourceIterator defined by a program using ASFormatter as a class
+// only the pure virtual functions are defined
+//----------------------------------------------------------------------------
+
+class LineVectorIterator : public ASSourceIterator
+{
+public:
+	explicit LineVectorIterator(const vector<string>& lines_)
+		: lines(lines_), current(0), peek(0) {}
+	streamoff getPeekStart() const override { return peek == 0 ? 0 : current + 1; }
+	int getStreamLength() const override { return (int) lines.size(); }
+	bool hasMoreLines() const override { return (peek == 0 ? current : current + peek) < lines.size(); }
+	string nextLine(bool) override { return lines[current++]; }
+	string peekNextLine() override { return lines[current + peek++]; }
+	void peekReset() override { peek = 0; }
+	streamoff tellg() override { return current + peek; }
+
+private:
+	vector<string> lines;
+	size_t current;
+	size_t peek;
+};
+
+TEST(SourceIterator, UserDefinedIterator)
+// test formatting from an iterator that defines only the by-value functions
+// the results must be the same as ASBufferIterator
+{
+	string text =
+	    "void foo()\n"
+	    "{\n"
+	    "if (isFoo)\n"
+	    "bar();\n"
+	    "else\n"
+	    "baz();\n"
+	    "}";
+	vector<string> lines;
+	stringstream in(text);
+	string line;
+	while (getline(in, line))
+		lines.push_back(line);
+
+	ASFormatter bufferFormatter;
+	bufferFormatter.setBreakBlocksMode(true);
+	ASBufferIterator bufferIterator(text.data(), text.length());
+	bufferFormatter.init(&bufferIterator);
+	vector<string> expected;
+	while (bufferFormatter.hasMoreLines())
+		expected.push_back(bufferFormatter.nextLine());
+
+	ASFormatter vectorFormatter;
+	vectorFormatter.setBreakBlocksMode(true);
+	LineVectorIterator vectorIterator(lines);
+	vectorFormatter.init(&vectorIterator);
+	vector<string> actual;
+	while (vectorFormatter.hasMoreLines())
+		actual.push_back(vectorFormatter.nextLine());
+	EXPECT_EQ(expected, actual);
+}
+
+//----------------------------------------------------------------------------
+// AStyle ASStreamingIterator tests
+// the results must be the same as ASStreamIterator<stringstream>
+//----------------------------------------------------------------------------
+
+int openTestFile(const string& fileName)
+// open a test file for reading with a file descriptor
+{
+#ifdef _WIN32
+	return _open(fileName.c_str(), _O_RDONLY | _O_BINARY);
+#else
+	return open(fileName.c_str(), O_RDONLY);
+#endif
+}
+
+void closeTestFile(int fd)
+{
+#ifdef _WIN32
+	_close(fd);
+#else
+	close(fd);
+#endif
+}
+
+TEST(StreamingIterator, SameAsStreamIterator)
+// test that ASStreamingIterator has the same results as ASStreamIterator
+{
+	ASFormatter formatter;
+	unique_ptr<ASConsole> console(new ASConsole(formatter));
+	cleanTestDirectory(getTestDirectory());
+	string fileName = getTestDirectory() + "/streamingIterator.cpp";
+	console->standardizePath(fileName);
+	vector<string> textIn;
+	textIn.push_back("");
+	textIn.push_back("a");
+	textIn.push_back("a\n");
+	textIn.push_back("a\nb");
+	textIn.push_back("\n\n\n");
+	textIn.push_back("a\r\nb\r\n");
+	textIn.push_back("a\r\nb\r\nc");
+	textIn.push_back("a\rb\r");
+	textIn.push_back("a\rb\rc");
+	textIn.push_back("a\n\rb\n\r");
+	textIn.push_back("a\r\nb\nc\rd\n\re");
+	textIn.push_back("\r\r\n\n\r\n");
+	textIn.push_back("\nvoid foo()\r{\r\n    bar();\n}\r");
+	// larger than the read block, with a CR+LF split between blocks
+	string large;
+	while (large.length() < 65535)
+		large += "    bar();\r\n";
+	large.resize(65535);
+	large += "\r\n}\r\n";
+	textIn.push_back(large + large + large);
+	for (size_t i = 0; i < textIn.size(); i++)
+	{
+		stringstream in(textIn[i]);
+		ASStreamIterator<stringstream> streamIterator(&in);
+		vector<string> streamTrace = getIteratorTrace(streamIterator);
+		createTestFile(fileName, textIn[i].c_str(), static_cast<int>(textIn[i].length()));
+		int fd = openTestFile(fileName);
+		ASSERT_TRUE(fd >= 0);
+		ASStreamingIterator streamingIterator(fd);
+		vector<string> streamingTrace = getIteratorTrace(streamingIterator);
+		closeTestFile(fd);
+		EXPECT_FALSE(streamingIterator.hasReadError());
+		EXPECT_EQ(streamTrace, streamingTrace) << "text number " << i;
+	}
+}
+
+#ifndef _WIN32
+TEST(StreamingIterator, LinesBeforeEndOfInput)
+// test that lines are returned before the input has ended
+{
+	int pipeFd[2];
+	ASSERT_EQ(0, pipe(pipeFd));
+	mutex lineMutex;
+	condition_variable lineRead;
+	bool isFirstLineRead = false;
+	thread writer([&]()
+	{
+		string first = "line1\nline2\n";
+		EXPECT_EQ(static_cast<ssize_t>(first.length()), write(pipeFd[1], first.c_str(), first.length()));
+		// the rest of the input is not sent until the first line is returned
+		unique_lock<mutex> lock(lineMutex);
+		lineRead.wait(lock, [&]() { return isFirstLineRead; });
+		string rest = "line3";
+		EXPECT_EQ(static_cast<ssize_t>(rest.length()), write(pipeFd[1], rest.c_str(), rest.length()));
+		close(pipeFd[1]);
+	});
+	ASStreamingIterator streamingIterator(pipeFd[0]);
+	EXPECT_EQ("line1", streamingIterator.nextLine(false));
+	{
+		lock_guard<mutex> lock(lineMutex);
+		isFirstLineRead = true;
+	}
+	lineRead.notify_one();
+	EXPECT_EQ("line2", streamingIterator.nextLine(false));
+	EXPECT_EQ("line3", streamingIterator.nextLine(false));
+	EXPECT_FALSE(streamingIterator.hasMoreLines());
+	writer.join();
+	close(pipeFd[0]);
+}
+#endif
+
+//----------------------------------------------------------------------------
+// AStyle mapped file tests
+//----------------------------------------------------------------------------
+
+TEST(MappedFile, FileText)
+// test that the mapped file has the same text as the file
+{
+	ASFormatter formatter;
+	unique_ptr<ASConsole> console(new ASConsole(formatter));
+	char text[] =
+	    "\nvoid foo()\r\n"
+	    "{\r"
+	    "    bar();\n"
+	    "}";
+	cleanTestDirectory(getTestDirectory());
+	string fileName = getTestDirectory() + "/mappedFile.cpp";
+	console->standardizePath(fileName);
+	createTestFile(fileName, text);
+	ASMappedFile mappedFile;
+	ASSERT_TRUE(mappedFile.open(fileName));
+	EXPECT_EQ(string(text), string(mappedFile.getData(), mappedFile.getSize()));
+	mappedFile.close();
+	EXPECT_TRUE(mappedFile.getData() == nullptr);
+	EXPECT_EQ(0U, mappedFile.getSize());
+}
+
+TEST(MappedFile, EmptyOrMissingFile)
+// test that empty and missing files are not mapped
+{
+	ASFormatter formatter;
+	unique_ptr<ASConsole> console(new ASConsole(formatter));
+	cleanTestDirectory(getTestDirectory());
+	string fileName = getTestDirectory() + "/mappedEmpty.cpp";
+	console->standardizePath(fileName);
+	createTestFile(fileName, "");
+	ASMappedFile mappedFile;
+	EXPECT_FALSE(mappedFile.open(fileName));
+	EXPECT_TRUE(mappedFile.getData() == nullptr);
+	string missingName = getTestDirectory() + "/mappedMissing.cpp";
+	console->standardizePath(missingName);
+	EXPECT_FALSE(mappedFile.open(missingName));
+}
+
+TEST(MappedFile, FormatMappedFile)
+// test that a mapped file is formatted and the original is backed up
+{
+	ASFormatter formatter;
+	unique_ptr<ASConsole> console(new ASConsole(formatter));
+	console->setIsQuiet(true);		// change this to see results
+	char textIn[] =
+	    "\nvoid foo()\n"
+	    "{\n"
+	    "bar();\n"
+	    "}\n";
+	char textOut[] =
+	    "\nvoid foo()\n"
+	    "{\n"
+	    "    bar();\n"
+	    "}\n";
+	cleanTestDirectory(getTestDirectory());
+	string fileName = getTestDirectory() + "/mappedFormat.cpp";
+	console->standardizePath(fileName);
+	createTestFile(fileName, textIn);
+	vector<string> astyleOptionsVector;
+	astyleOptionsVector.push_back(fileName);
+	console->processOptions(astyleOptionsVector);
+	console->processFiles();
+	EXPECT_EQ(1, console->getFilesFormatted());
+	ASMappedFile mappedFile;
+	ASSERT_TRUE(mappedFile.open(fileName));
+	EXPECT_EQ(string(textOut), string(mappedFile.getData(), mappedFile.getSize()));
+	ASSERT_TRUE(mappedFile.open(fileName + ".orig"));
+	EXPECT_EQ(string(textIn), string(mappedFile.getData(), mappedFile.getSize()));
+}
+
 //----------------------------------------------------------------------------
 // AStyle other tests
 //----------------------------------------------------------------------------
@@ -438,9 +756,9 @@ TEST(Other, MingwFileGlobbing)
 }
 
 TEST(Other, GlobalPreprocessorExternBracket)
-// Test that g_preprocessorCppExternCBracket is reset for each file.
+// Test that preprocessorCppExternCBrace is reset for each file.
 {
-	// The ASBeautifier global variable g_preprocessorCppExternCBracket
+	// The ASBeautifier variable preprocessorCppExternCBrace
 	// must be cleared in the "init" method instead of the constructor.
 	// If not cleared, the "int a;" will not be indented
 	ASFormatter formatter;
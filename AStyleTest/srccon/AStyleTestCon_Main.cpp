@@ -122,7 +122,7 @@ int main(int argc, char** argv)
 			TersePrinter::PrintTestTotals(40, __FILE__, __LINE__);
 		else
 			// Change the following value to the number of tests (within 20).
-			TersePrinter::PrintTestTotals(140, __FILE__, __LINE__);
+			TersePrinter::PrintTestTotals(180, __FILE__, __LINE__);
 		if (g_isI18nTest)
 			printI18nMessage();
 	}
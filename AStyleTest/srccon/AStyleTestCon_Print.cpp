@@ -340,6 +340,35 @@ TEST_F(PrintF, DefaultWildcard)
 	EXPECT_EQ(text, textOut);
 }
 
+TEST_F(PrintF, DefaultWildcard_Jobs)
+// test print wildcard with the jobs option
+{
+	// expected text
+	string text =
+	    "------------------------------------------------------------\n"
+	    "Directory  <test_directory>/*.cpp\n"
+	    "------------------------------------------------------------\n"
+	    "Formatted  fileFormatted.cpp\n"
+	    "Unchanged  fileUnchanged.cpp\n";
+	adjustText(text);
+	// call astyle processOptions()
+	vector<string> astyleOptionsVector;
+	astyleOptionsVector.push_back("--ascii");
+	astyleOptionsVector.push_back("--jobs=2");
+	astyleOptionsVector.push_back(getTestDirectory() + "/*.cpp");
+	console->processOptions(astyleOptionsVector);
+	// redirect stdout and get the report
+	redirectStream();
+	console->processFiles();
+	string textOut = restoreStream();
+	adjustTextOut(textOut);
+	// check entries in the fileNameVector
+	vector<string> fileName = console->getFileName();
+	ASSERT_EQ(fileNames.size(), fileName.size()) << "Print format was not checked.";
+	// check the report content
+	EXPECT_EQ(text, textOut);
+}
+
 TEST_F(PrintF, DefaultWildcard_Exclude)
 // test print wildcard with an exclude
 {
@@ -40,7 +40,7 @@ extern bool g_testedCodepage1252;
 //-------------------------------------------------------------------------
 
 namespace astyle {
-extern char g_fileSeparator;
+extern const char g_fileSeparator;
 }
 
 string convertToMultiByte(const wstring& wideStr);
@@ -321,7 +321,7 @@ struct ASEncoding_Class : public Test
 	// test Astyle utf16ToUtf8() function return
 	char* utf8Out = new char[utf8ComputedSize + 1];
 	size_t utf8ConvertedSize = utf8_16.utf16ToUtf8(const_cast<char*>(text16Bit),
-	                                               text16Len + 1, isBigEndian, true, utf8Out);
+	                                               text16Len + 1, isBigEndian, utf8Out);
 	EXPECT_EQ(text8Len + 1, utf8ConvertedSize);
 	// test Astyle utf16ToUtf8() function text conversion
 	EXPECT_STREQ(utf8Out, text8Bit);
@@ -347,7 +347,7 @@ struct ASEncoding_Class : public Test
 	// test Astyle utf16ToUtf8() function return
 	char* utf8Out = new char[utf8ComputedSize + 1];
 	size_t utf8ConvertedSize = utf8_16.utf16ToUtf8(const_cast<char*>(text16Bit),
-	                                               text16Len + 1, isBigEndian, true, utf8Out);
+	                                               text16Len + 1, isBigEndian, utf8Out);
 	EXPECT_EQ(text8Len + 1, utf8ConvertedSize);
 	// test Astyle utf16ToUtf8() function text conversion
 	EXPECT_TRUE(strncmp(utf8Out, text8Bit, text8Len) == 0);
@@ -14,6 +14,9 @@
 #include "astyle_main.h"
 using namespace astyle;
 
+#include <memory>
+#include <thread>
+
 #ifdef _WIN32
 	#include <windows.h>
 #else
@@ -295,6 +298,434 @@ TEST_F(AStyleMainF1, InvalidOption)
 	delete[] textOut;
 }
 
+TEST_F(AStyleMainF1, InvalidOptionEveryCall)
+{
+	// test that an invalid option is reported by each call in the thread
+	// the formatter with the error must not be reused
+	char options[] = "invalid-option, indent=tab";
+	int errorsIn = getErrorHandler2Calls();
+	for (int i = 0; i < 2; i++)
+	{
+		char* textOut = ::AStyleMain(text8, options, errorHandler2, memoryAlloc);
+		EXPECT_TRUE(textOut != nullptr);
+		delete[] textOut;
+	}
+	int errorsOut = getErrorHandler2Calls();
+	EXPECT_EQ(errorsIn + 2, errorsOut);
+}
+
+TEST_F(AStyleMainF1, ReusedFormatterOptionsChange)
+{
+	// test that the formatter kept by the thread is replaced when the options change
+	char textTab[] =
+	    "\nvoid foo()\n"
+	    "{\n"
+	    "\tbar();\n"
+	    "}\n";
+	char textSpaces[] =
+	    "\nvoid foo()\n"
+	    "{\n"
+	    "  bar();\n"
+	    "}\n";
+	const char* options[] = { "indent=tab", "indent=tab", "indent=spaces=2", "indent=tab" };
+	const char* expected[] = { textTab, textTab, textSpaces, textTab };
+	for (int i = 0; i < 4; i++)
+	{
+		char* textOut = ::AStyleMain(text8, options[i], errorHandler2, memoryAlloc);
+		EXPECT_STREQ(expected[i], textOut);
+		delete[] textOut;
+	}
+}
+
+char* nestedTextOut;	// output of the AStyleMain call in memoryAllocNested
+
+char* STDCALL memoryAllocNested(unsigned long memoryNeeded)
+// Call AStyleMain with other options while the first call is formatting.
+{
+	char text[] = "void foo() { bar(); }\n";
+	nestedTextOut = ::AStyleMain(text, "style=allman", errorHandler2, memoryAlloc);
+	return new (nothrow) char[memoryNeeded];
+}
+
+TEST_F(AStyleMainF1, NestedCallFromCallback)
+{
+	// test an AStyleMain call from a callback function of AStyleMain
+	// the formatter in use must not be replaced by the nested call
+	char text[] =
+	    "\nvoid foo()\n"
+	    "{\n"
+	    "\tbar();\n"
+	    "}\n";
+	char textNested[] =
+	    "void foo()\n"
+	    "{\n"
+	    "    bar();\n"
+	    "}\n";
+	char options[] = "indent=tab";
+	// the first call keeps the formatter for the second call
+	char* textOut = ::AStyleMain(text8, options, errorHandler2, memoryAlloc);
+	delete[] textOut;
+	nestedTextOut = nullptr;
+	textOut = ::AStyleMain(text8, options, errorHandler2, memoryAllocNested);
+	EXPECT_STREQ(text, textOut);
+	EXPECT_STREQ(textNested, nestedTextOut);
+	delete[] textOut;
+	delete[] nestedTextOut;
+	// the formatter kept by the thread is the one from the nested call
+	textOut = ::AStyleMain(text8, options, errorHandler2, memoryAlloc);
+	EXPECT_STREQ(text, textOut);
+	delete[] textOut;
+}
+
+TEST_F(AStyleMainF1, LargeBufferNotKept)
+{
+	// test that the thread does not keep the output buffer of a large file
+	// the buffer of a small file is kept for the next call
+	char options[] = "indent=tab";
+	char* textOut = ::AStyleMain(text8, options, errorHandler2, memoryAlloc);
+	delete[] textOut;
+	size_t smallCapacity = ASLibraryFormatter::getThreadBufferCapacity();
+	EXPECT_TRUE(smallCapacity > 0);
+	EXPECT_TRUE(smallCapacity < 1024 * 1024);
+	// build a source over the size limit
+	string textLarge = "\nvoid foo()\n{\n";
+	while (textLarge.length() < 1024 * 1024)
+		textLarge.append("bar();\n");
+	textLarge.append("}\n");
+	textOut = ::AStyleMain(textLarge.c_str(), options, errorHandler2, memoryAlloc);
+	ASSERT_TRUE(textOut != nullptr);
+	EXPECT_TRUE(strlen(textOut) > textLarge.length());
+	delete[] textOut;
+	EXPECT_TRUE(ASLibraryFormatter::getThreadBufferCapacity() < 1024 * 1024);
+	// the next small file builds a new buffer
+	textOut = ::AStyleMain(text8, options, errorHandler2, memoryAlloc);
+	delete[] textOut;
+	EXPECT_EQ(smallCapacity, ASLibraryFormatter::getThreadBufferCapacity());
+}
+
+//----------------------------------------------------------------------------
+// Test AStyleCreate, AStyleFormat, and AStyleDestroy
+// This uses the test fixture from above.
+//----------------------------------------------------------------------------
+
+TEST_F(AStyleMainF1, CreateFormatDestroy)
+{
+	// test formatting with a handle and the returned length
+	char text[] =
+	    "\nvoid foo()\n"
+	    "{\n"
+	    "\tbar();\n"
+	    "}\n";
+	char options[] = "indent=tab";
+	int errorsIn = getErrorHandler2Calls();
+	AStyleHandle handle = ::AStyleCreate(options, errorHandler2, memoryAlloc);
+	ASSERT_TRUE(handle != nullptr);
+	unsigned long textLength = 0;
+	char* textOut = ::AStyleFormat(handle, text8, strlen(text8), &textLength);
+	::AStyleDestroy(handle);
+	int errorsOut = getErrorHandler2Calls();
+	EXPECT_EQ(errorsIn, errorsOut);
+	EXPECT_STREQ(text, textOut);
+	EXPECT_EQ(strlen(text), textLength);
+	delete[] textOut;
+}
+
+TEST_F(AStyleMainF1, FormatReusesHandle)
+{
+	// test that a handle gives the same output as AStyleMain for several calls
+	char options[] = "style=allman, indent=spaces=2";
+	char text2[] =
+	    "class Foo {\n"
+	    "public:\n"
+	    "int bar() { return 1; }\n"
+	    "};\n";
+	AStyleHandle handle = ::AStyleCreate(options, errorHandler2, memoryAlloc);
+	ASSERT_TRUE(handle != nullptr);
+	for (int i = 0; i < 3; i++)
+	{
+		const char* textIn = (i % 2 == 0) ? text8 : text2;
+		char* textMain = ::AStyleMain(textIn, options, errorHandler2, memoryAlloc);
+		unsigned long textLength = 0;
+		char* textOut = ::AStyleFormat(handle, textIn, strlen(textIn), &textLength);
+		EXPECT_STREQ(textMain, textOut);
+		EXPECT_EQ(strlen(textMain), textLength);
+		delete[] textMain;
+		delete[] textOut;
+	}
+	::AStyleDestroy(handle);
+}
+
+TEST_F(AStyleMainF1, FormatExplicitLength)
+{
+	// test that the source is not read past the given length
+	char text[] =
+	    "\nvoid foo()\n"
+	    "{\n"
+	    "    bar();\n"
+	    "}\n";
+	string textIn = string(text8) + "void extra()\n{ }\n";
+	AStyleHandle handle = ::AStyleCreate(options8, errorHandler2, memoryAlloc);
+	ASSERT_TRUE(handle != nullptr);
+	unsigned long textLength = 0;
+	char* textOut = ::AStyleFormat(handle, textIn.c_str(), strlen(text8), &textLength);
+	::AStyleDestroy(handle);
+	EXPECT_STREQ(text, textOut);
+	EXPECT_EQ(strlen(text), textLength);
+	delete[] textOut;
+}
+
+TEST_F(AStyleMainF1, FormatNullLengthPointer)
+{
+	// test that the output length pointer is optional
+	AStyleHandle handle = ::AStyleCreate(options8, errorHandler2, memoryAlloc);
+	ASSERT_TRUE(handle != nullptr);
+	char* textOut = ::AStyleFormat(handle, text8, strlen(text8), nullptr);
+	::AStyleDestroy(handle);
+	EXPECT_STREQ(text8, textOut);
+	delete[] textOut;
+}
+
+TEST_F(AStyleMainF1, CreateNullPointers)
+{
+	// test error handling for NULL pointers to AStyleCreate
+	int errorsIn = getErrorHandler2Calls();
+	AStyleHandle handle = ::AStyleCreate(nullptr, errorHandler2, memoryAlloc);
+	EXPECT_EQ(errorsIn + 1, getErrorHandler2Calls());
+	EXPECT_TRUE(handle == nullptr);
+	handle = ::AStyleCreate(options8, errorHandler2, nullptr);
+	EXPECT_EQ(errorsIn + 2, getErrorHandler2Calls());
+	EXPECT_TRUE(handle == nullptr);
+	// this cannot call the error handler
+	handle = ::AStyleCreate(options8, nullptr, memoryAlloc);
+	EXPECT_TRUE(handle == nullptr);
+}
+
+TEST_F(AStyleMainF1, FormatNullPointers)
+{
+	// test error handling for NULL pointers to AStyleFormat
+	// a NULL handle cannot call the error handler
+	int errorsIn = getErrorHandler2Calls();
+	char* textOut = ::AStyleFormat(nullptr, text8, strlen(text8), nullptr);
+	EXPECT_EQ(errorsIn, getErrorHandler2Calls());
+	EXPECT_TRUE(textOut == nullptr);
+	AStyleHandle handle = ::AStyleCreate(options8, errorHandler2, memoryAlloc);
+	ASSERT_TRUE(handle != nullptr);
+	textOut = ::AStyleFormat(handle, nullptr, 0, nullptr);
+	::AStyleDestroy(handle);
+	EXPECT_EQ(errorsIn + 1, getErrorHandler2Calls());
+	EXPECT_TRUE(textOut == nullptr);
+	// destroying a NULL handle is allowed
+	::AStyleDestroy(nullptr);
+}
+
+TEST_F(AStyleMainF1, CreateInvalidOption)
+{
+	// test error handling for an invalid option
+	// no handle is returned for this error
+	char options[] = "invalid-option, indent=tab";
+	int errorsIn = getErrorHandler2Calls();
+	AStyleHandle handle = ::AStyleCreate(options, errorHandler2, memoryAlloc);
+	int errorsOut = getErrorHandler2Calls();
+	EXPECT_EQ(errorsIn + 1, errorsOut);
+	EXPECT_TRUE(handle == nullptr);
+}
+
+//----------------------------------------------------------------------------
+// Test concurrent formatting with AStyleMainContext and AStyleCreateContext
+//----------------------------------------------------------------------------
+
+struct ThreadContext
+// the calling program context for each thread
+{
+	int errors = 0;
+	int allocations = 0;
+	int mismatches = 0;
+};
+
+void STDCALL errorHandlerContext(void* context, int, const char*)
+{
+	static_cast<ThreadContext*>(context)->errors++;
+}
+
+char* STDCALL memoryAllocContext(void* context, unsigned long memoryNeeded)
+{
+	static_cast<ThreadContext*>(context)->allocations++;
+	return new (nothrow) char[memoryNeeded];
+}
+
+struct AStyleThreadsF : public Test
+// The sources and options exercise the C/C++, Java, C#, and Objective-C
+// paths and the preprocessor extern "C" brace state.
+{
+	vector<pair<string, string> > sources;
+	vector<string> serialOutput;
+
+	// c'tor - set the sources and the serial output
+	AStyleThreadsF()
+	{
+		sources.emplace_back(
+		    "#ifdef __cplusplus\n"
+		    "extern \"C\" {\n"
+		    "#endif\n"
+		    "void foo() { if (isFoo) bar(); }\n"
+		    "#ifdef __cplusplus\n"
+		    "}\n"
+		    "#endif\n",
+		    "style=allman, indent-preproc-block, add-braces");
+		sources.emplace_back(
+		    "int main(){for(int i=0;i<10;i++){if(i){a=b+c;}}return 0;}\n",
+		    "style=gnu, pad-oper, pad-header, break-one-line-headers");
+		sources.emplace_back(
+		    "public class Foo { void foo() { if (isFoo) { bar(); } else { baz(); } } }\n",
+		    "style=java, mode=java, break-blocks");
+		sources.emplace_back(
+		    "namespace Foo { class Bar { int Baz { get; set; } } }\n",
+		    "style=kr, mode=cs, indent-namespaces");
+		sources.emplace_back(
+		    "-(void)foo\n"
+		    "{\n"
+		    "[myObj methodOne:param1\n"
+		    "methodTwo:param2\n"
+		    "methodThree:param3];\n"
+		    "}\n",
+		    "align-method-colon, pad-method-colon=none");
+		for (size_t i = 0; i < sources.size(); i++)
+		{
+			char* textOut = ::AStyleMain(sources[i].first.c_str(), sources[i].second.c_str(),
+			                             errorHandler, memoryAlloc);
+			serialOutput.emplace_back(textOut);
+			delete[] textOut;
+		}
+	}
+};
+
+void formatInThread(const AStyleThreadsF* fixture, ThreadContext* context, int iterations)
+// Format the fixture sources with AStyleMainContext and with a handle
+// for each source, and count the outputs that differ from the serial run.
+{
+	const vector<pair<string, string> >& sources = fixture->sources;
+	vector<AStyleHandle> handles;
+	for (size_t i = 0; i < sources.size(); i++)
+		handles.push_back(::AStyleCreateContext(sources[i].second.c_str(),
+		                                        errorHandlerContext, memoryAllocContext, context));
+	for (int n = 0; n < iterations; n++)
+	{
+		for (size_t i = 0; i < sources.size(); i++)
+		{
+			char* textOut = ::AStyleMainContext(sources[i].first.c_str(), sources[i].second.c_str(),
+			                                    errorHandlerContext, memoryAllocContext, context);
+			if (textOut == nullptr || fixture->serialOutput[i] != textOut)
+				context->mismatches++;
+			delete[] textOut;
+			unsigned long textLength = 0;
+			textOut = ::AStyleFormat(handles[i], sources[i].first.c_str(), sources[i].first.length(),
+			                         &textLength);
+			if (textOut == nullptr || fixture->serialOutput[i] != string(textOut, textLength))
+				context->mismatches++;
+			delete[] textOut;
+		}
+	}
+	for (size_t i = 0; i < handles.size(); i++)
+		::AStyleDestroy(handles[i]);
+}
+
+TEST_F(AStyleThreadsF, ParallelEqualsSerial)
+{
+	// test that formatting from several threads gives the serial output
+	const int numThreads = 8;
+	const int iterations = 25;
+	vector<ThreadContext> contexts(numThreads);
+	vector<thread> threads;
+	for (int i = 0; i < numThreads; i++)
+		threads.emplace_back(formatInThread, this, &contexts[i], iterations);
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+	// the results are checked here, gtest assertions may not be thread safe
+	int expectedAllocations = iterations * static_cast<int>(sources.size()) * 2;
+	for (int i = 0; i < numThreads; i++)
+	{
+		EXPECT_EQ(0, contexts[i].mismatches);
+		EXPECT_EQ(0, contexts[i].errors);
+		EXPECT_EQ(expectedAllocations, contexts[i].allocations);
+	}
+}
+
+struct InterleavedFormatter
+// Format a source one line at a time so that several formatters
+// are active in the same thread.
+{
+	ASFormatter formatter;
+	ASBufferIterator streamIterator;
+	string textOut;
+
+	explicit InterleavedFormatter(const pair<string, string>& source)
+		: streamIterator(source.first.c_str(), source.first.length())
+	{
+		ASOptions options(formatter);
+		vector<string> optionsVector;
+		stringstream opt(source.second);
+		options.importOptions(opt, optionsVector);
+		options.parseOptions(optionsVector, "Invalid Artistic Style options:");
+		formatter.init(&streamIterator);
+	}
+
+	// output the next line, return false when the source is finished
+	bool formatLine()
+	{
+		if (!formatter.hasMoreLines())
+			return false;
+		textOut.append(formatter.nextLine());
+		if (formatter.hasMoreLines())
+			textOut.append(streamIterator.getOutputEOL());
+		else if (formatter.getIsLineReady())
+		{
+			textOut.append(streamIterator.getOutputEOL());
+			textOut.append(formatter.nextLine());
+		}
+		return true;
+	}
+};
+
+TEST_F(AStyleThreadsF, InterleavedEqualsSerial)
+{
+	// test that formatters in the same thread do not share state
+	// each formatter is started after the previous one has output a line
+	vector<unique_ptr<InterleavedFormatter> > formatters;
+	bool isFormatting = true;
+	while (isFormatting || formatters.size() < sources.size())
+	{
+		if (formatters.size() < sources.size())
+			formatters.emplace_back(new InterleavedFormatter(sources[formatters.size()]));
+		isFormatting = false;
+		for (size_t i = 0; i < formatters.size(); i++)
+			if (formatters[i]->formatLine())
+				isFormatting = true;
+	}
+	for (size_t i = 0; i < sources.size(); i++)
+		EXPECT_EQ(serialOutput[i], formatters[i]->textOut);
+}
+
+TEST_F(AStyleThreadsF, ContextPassedToCallbacks)
+{
+	// test that the context pointer is passed to both callback functions
+	ThreadContext context;
+	char* textOut = ::AStyleMainContext(sources[0].first.c_str(), "invalid-option",
+	                                    errorHandlerContext, memoryAllocContext, &context);
+	EXPECT_EQ(1, context.errors);
+	EXPECT_EQ(1, context.allocations);
+	EXPECT_TRUE(textOut != nullptr);
+	delete[] textOut;
+	// errors that do not format
+	textOut = ::AStyleMainContext(nullptr, "", errorHandlerContext, memoryAllocContext, &context);
+	EXPECT_EQ(2, context.errors);
+	EXPECT_TRUE(textOut == nullptr);
+	AStyleHandle handle = ::AStyleCreateContext("invalid-option", errorHandlerContext,
+	                                            memoryAllocContext, &context);
+	EXPECT_EQ(3, context.errors);
+	EXPECT_TRUE(handle == nullptr);
+	EXPECT_EQ(1, context.allocations);
+}
+
 //----------------------------------------------------------------------------
 // Test error reporting conditions in AStyleMainUtf16
 //----------------------------------------------------------------------------
@@ -533,6 +964,45 @@ struct AStyleMainUtf16F2 : public Test
 #endif // __BORLANDC__
 }
 
+void formatUtf16InThread(const char16_t* text16, const char16_t* options16,
+                         const char16_t* expected16, int iterations, int* mismatches)
+// Format utf-16 text and count the outputs that differ from the expected text.
+{
+	size_t expectedLen = utf16len(expected16);
+	for (int i = 0; i < iterations; i++)
+	{
+		char16_t* text16Out = ::AStyleMainUtf16(text16, options16, errorHandler, memoryAlloc);
+		if (text16Out == nullptr
+		        || utf16len(text16Out) != expectedLen
+		        || memcmp(text16Out, expected16, expectedLen * sizeof(char16_t)) != 0)
+			(*mismatches)++;
+		delete[] text16Out;
+	}
+}
+
+#ifdef __APPLE__
+	TEST_F(AStyleMainUtf16F2, DISABLED_ParallelUtf16)
+#else
+	TEST_F(AStyleMainUtf16F2, ParallelUtf16)
+#endif
+{
+#ifndef __BORLANDC__
+	// Test the utf-16 conversions from several threads.
+	char16_t* expected16 = ::AStyleMainUtf16(text16, options16, errorHandler, memoryAlloc);
+	ASSERT_TRUE(expected16 != nullptr);
+	const int numThreads = 8;
+	vector<int> mismatches(numThreads, 0);
+	vector<thread> threads;
+	for (int i = 0; i < numThreads; i++)
+		threads.emplace_back(formatUtf16InThread, text16, options16, expected16, 50, &mismatches[i]);
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+	for (int i = 0; i < numThreads; i++)
+		EXPECT_EQ(0, mismatches[i]);
+	delete[] expected16;
+#endif // __BORLANDC__
+}
+
 //----------------------------------------------------------------------------
 
 }  // namespace